@@ -0,0 +1,41 @@
+//
+// Exponential backoff for retrying a failed CAS.
+//
+// Every pause() spins twice as long as the previous one, up to maxDelay
+// spins. The spins use the pause instruction (yield on AArch64), which
+// tells the core that it is spin waiting: it saves power and gives the
+// sibling hyper-thread the pipeline. Meanwhile the contended cache line is
+// left alone, so the thread that holds it can finish.
+//
+
+#ifndef BACKOFF_HPP
+#define BACKOFF_HPP
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+class Backoff {
+public:
+    static constexpr unsigned maxDelay{1024};
+
+    void pause();
+
+private:
+    unsigned delay{1};
+};
+
+inline void Backoff::pause() {
+    for (unsigned i{0}; i < delay; ++i) {
+        cpuRelax();
+    }
+    if (delay < maxDelay) {
+        delay *= 2;
+    }
+}
+
+#endif
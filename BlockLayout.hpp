@@ -0,0 +1,41 @@
+//
+// Layout helpers for memory blocks that keep their header and their
+// payload in a single allocation.
+// The payload starts at a fixed offset from the header, so getting to
+// the data is pointer arithmetic instead of a pointer dereference.
+//
+
+#ifndef BLOCK_LAYOUT_HPP
+#define BLOCK_LAYOUT_HPP
+
+#include <cstddef>
+
+constexpr std::size_t alignUp(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Alignment that a plain new uint8_t[] gives.
+constexpr std::size_t defaultBlockAlignment{alignof(std::max_align_t)};
+
+constexpr std::size_t cacheLineSize{64};
+
+constexpr bool isPowerOfTwo(std::size_t value) {
+    return (value != 0) && ((value & (value - 1)) == 0);
+}
+
+// Offset of the payload from the start of a block header of type Header.
+template<typename Header>
+constexpr std::size_t blockPayloadOffset() {
+    return alignUp(sizeof(Header), defaultBlockAlignment);
+}
+
+// Distance of two neighbouring blocks carved out of a slab.
+// The header of a block sits right before its payload. With cache line or
+// larger alignment the payload is padded to whole cache lines so that the
+// header of the next block is not on the last payload line.
+constexpr std::size_t blockSlotSize(std::size_t headerSize, std::size_t blockSize, std::size_t alignment) {
+    return alignUp(headerSize + ((alignment >= cacheLineSize) ? alignUp(blockSize, cacheLineSize) : blockSize),
+                   alignment);
+}
+
+#endif
@@ -0,0 +1,16 @@
+#include <algorithm>
+#include <unistd.h>
+#include "CurrentCpu.hpp"
+
+unsigned getCpuCount() {
+    const long count{sysconf(_SC_NPROCESSORS_CONF)};
+    return static_cast<unsigned>(std::max(count, 1L));
+}
+
+bool isRseqAvailable() {
+#ifdef RSEQ_SIG
+    return __rseq_size > 0;
+#else
+    return false;
+#endif
+}
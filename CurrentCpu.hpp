@@ -0,0 +1,47 @@
+//
+// Tells which CPU the calling thread is running on.
+//
+// glibc 2.35 and later registers a restartable sequences (rseq) area for
+// every thread when the kernel supports it, and the kernel keeps the cpu_id
+// field of that area up to date. Reading it is one load from thread local
+// memory. Without rseq it falls back to sched_getcpu() (a vDSO call on
+// x86-64).
+//
+// The thread may migrate right after the call, so the answer is only a
+// hint. Use it to pick data that is probably not used by other CPUs, not
+// to replace synchronization.
+//
+
+#ifndef CURRENT_CPU_HPP
+#define CURRENT_CPU_HPP
+
+#include <sched.h>
+
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#endif
+
+// Number of CPUs the system may have (including offline ones).
+// Every CPU number returned by getCurrentCpu() is less than this.
+unsigned getCpuCount();
+
+// Whether getCurrentCpu() reads the CPU number from the rseq area.
+bool isRseqAvailable();
+
+inline unsigned getCurrentCpu() {
+#ifdef RSEQ_SIG
+    if (__rseq_size > 0) {
+        auto area = reinterpret_cast<const volatile struct rseq *>(
+                static_cast<const char *>(__builtin_thread_pointer()) + __rseq_offset);
+        // Negative while the area is not registered.
+        const auto cpu = static_cast<int>(area->cpu_id);
+        if (cpu >= 0) {
+            return static_cast<unsigned>(cpu);
+        }
+    }
+#endif
+    const int cpu{sched_getcpu()};
+    return (cpu >= 0) ? static_cast<unsigned>(cpu) : 0;
+}
+
+#endif
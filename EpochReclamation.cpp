@@ -0,0 +1,74 @@
+#include "EpochReclamation.hpp"
+
+std::atomic<std::uint64_t> EpochReclamation::epoch{1};
+std::atomic<EpochReclamation::ThreadRecord *> EpochReclamation::records{nullptr};
+thread_local EpochReclamation::ThreadRecord * EpochReclamation::threadRecord{nullptr};
+
+namespace {
+
+// Gives the record of the thread back when the thread exits.
+// A guard used by a later thread exit handler claims a record again
+// and keeps it. That costs one record, not correctness.
+struct ThreadExit {
+    bool isExiting{false};
+    void (* release)(){nullptr};
+
+    ~ThreadExit() {
+        isExiting = true;
+        if (release != nullptr) {
+            release();
+        }
+    }
+};
+
+thread_local ThreadExit threadExit{};
+
+}
+
+EpochReclamation::ThreadRecord * EpochReclamation::claimThreadRecord() {
+    // Records are reused by later threads but never deleted, so the
+    // reclaimer can walk the list without protection.
+    ThreadRecord * record{nullptr};
+    for (ThreadRecord * item{records.load(std::memory_order_acquire)}; item != nullptr; item = item->next) {
+        bool isInUse{false};
+        if (item->isInUse.compare_exchange_strong(isInUse, true, std::memory_order_acquire)) {
+            record = item;
+            break;
+        }
+    }
+    if (record == nullptr) {
+        record = new ThreadRecord{};
+        record->next = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(record->next, record,
+                                              std::memory_order_release, std::memory_order_relaxed)) {
+            // Nothing
+        }
+    }
+
+    if (!threadExit.isExiting) {
+        threadExit.release = [] {
+            threadRecord->isInUse.store(false, std::memory_order_release);
+            threadRecord = nullptr;
+        };
+    }
+    return record;
+}
+
+std::uint64_t EpochReclamation::getRetireEpoch() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch.load(std::memory_order_relaxed);
+}
+
+std::uint64_t EpochReclamation::tryAdvance() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t current{epoch.load(std::memory_order_relaxed)};
+    for (ThreadRecord * item{records.load(std::memory_order_acquire)}; item != nullptr; item = item->next) {
+        const std::uint64_t state{item->state.load(std::memory_order_acquire)};
+        if ((state & 1) != 0 && (state >> 1) != current) {
+            return current;
+        }
+    }
+    // Another reclaimer may have advanced it meanwhile. Either way it moved on.
+    epoch.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel);
+    return epoch.load(std::memory_order_acquire);
+}
@@ -0,0 +1,94 @@
+//
+// Epoch based reclamation for the nodes of the lock free lists.
+//
+// A thread may read a node of a shared list (e.g. follow item->next) only
+// inside an EpochReclamation::Guard. A node that has been unlinked from the
+// list is retired with getRetireEpoch() and may be deleted once
+// isSafeToDelete() says so, i.e. once the global epoch has advanced twice.
+// The epoch only advances when every thread inside a guard has announced
+// the current epoch, so by then no thread can still hold a pointer to the
+// node it read from the list.
+//
+// Entering a guard costs one store and one fence. Guards may nest.
+// The epoch is shared by every list in the process.
+//
+
+#ifndef EPOCH_RECLAMATION_HPP
+#define EPOCH_RECLAMATION_HPP
+
+#include <atomic>
+#include <cstdint>
+
+class EpochReclamation {
+private:
+    struct ThreadRecord;
+
+public:
+    class Guard {
+    public:
+        Guard();
+
+        Guard(const Guard &) = delete;
+
+        ~Guard();
+
+    private:
+        ThreadRecord & record;
+    };
+
+    // The epoch to retire a node with. Call it after the node was unlinked.
+    static std::uint64_t getRetireEpoch();
+
+    // Advances the epoch if every thread inside a guard has seen it.
+    // Returns the epoch after the attempt.
+    static std::uint64_t tryAdvance();
+
+    static bool isSafeToDelete(std::uint64_t retireEpoch);
+
+private:
+    // The state of a thread is (epoch << 1) | 1 inside a guard and 0 outside.
+    struct alignas(64) ThreadRecord {
+        std::atomic<std::uint64_t> state{0};
+        std::atomic<bool> isInUse{true};
+        unsigned depth{0};
+        ThreadRecord * next{nullptr};
+    };
+
+    static std::atomic<std::uint64_t> epoch;
+    static std::atomic<ThreadRecord *> records;
+
+    // The record of the calling thread. Given back when the thread exits.
+    static thread_local ThreadRecord * threadRecord;
+
+    static ThreadRecord & getThreadRecord();
+
+    static ThreadRecord * claimThreadRecord();
+};
+
+inline EpochReclamation::ThreadRecord & EpochReclamation::getThreadRecord() {
+    if (threadRecord == nullptr) {
+        threadRecord = claimThreadRecord();
+    }
+    return *threadRecord;
+}
+
+inline EpochReclamation::Guard::Guard() : record{getThreadRecord()} {
+    if (record.depth++ == 0) {
+        record.state.store((epoch.load(std::memory_order_relaxed) << 1) | 1, std::memory_order_relaxed);
+        // Pairs with the fence in getRetireEpoch(): either the reclaimer sees
+        // this thread inside the guard or this thread sees the node unlinked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline EpochReclamation::Guard::~Guard() {
+    if (--record.depth == 0) {
+        record.state.store(0, std::memory_order_release);
+    }
+}
+
+inline bool EpochReclamation::isSafeToDelete(std::uint64_t retireEpoch) {
+    return epoch.load(std::memory_order_acquire) >= retireEpoch + 2;
+}
+
+#endif
@@ -0,0 +1,43 @@
+//
+// A LinkedMemBlock whose size and alignment are compile-time constants.
+// getAs<T>() checks at compile time that T fits into the block.
+//
+
+#ifndef FIXED_MEM_BLOCK_HPP
+#define FIXED_MEM_BLOCK_HPP
+
+#include <memory>
+#include <new>
+#include "LinkedMemBlock.hpp"
+
+template<std::size_t BlockSize, std::size_t Alignment>
+struct FixedMemBlock final : LinkedMemBlock {
+    static constexpr std::size_t size{BlockSize};
+    static constexpr std::size_t alignment{Alignment};
+
+    static std::unique_ptr<FixedMemBlock> create(SlabAllocator & allocator);
+
+    template<typename T>
+    T * getAs();
+
+private:
+    explicit FixedMemBlock(Slab * slab) : LinkedMemBlock{slab} {}
+};
+
+template<std::size_t BlockSize, std::size_t Alignment>
+std::unique_ptr<FixedMemBlock<BlockSize, Alignment>>
+FixedMemBlock<BlockSize, Alignment>::create(SlabAllocator & allocator) {
+    Slab * slab;
+    void * memory{allocator.allocate(slab)};
+    return std::unique_ptr<FixedMemBlock>(::new (memory) FixedMemBlock{slab});
+}
+
+template<std::size_t BlockSize, std::size_t Alignment>
+template<typename T>
+T * FixedMemBlock<BlockSize, Alignment>::getAs() {
+    static_assert(sizeof(T) <= BlockSize, "T does not fit into the block");
+    static_assert(alignof(T) <= Alignment, "T needs a stronger alignment than the block has");
+    return reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(this) + blockPayloadOffset<LinkedMemBlock>());
+}
+
+#endif
@@ -0,0 +1,95 @@
+//
+// This is the lock free memory cache with the block geometry fixed at
+// compile time.
+// The block size, the alignment and optionally the maximum number of
+// blocks are template parameters. The acquired blocks are FixedMemBlocks,
+// so getAs<T>() checks at compile time that T fits.
+//
+// With MaxCapacity all blocks are carved out of one slab that is sized
+// for MaxCapacity blocks, and upkeep() never allocates more than that.
+// MaxCapacity = 0 means no limit.
+//
+
+#ifndef FIXED_MEM_CACHE_HPP
+#define FIXED_MEM_CACHE_HPP
+
+#include <cstddef>
+#include <memory>
+#include "FixedMemBlock.hpp"
+#include "LockFreeLinkedMemCache.hpp"
+
+template<std::size_t BlockSize, std::size_t Alignment = defaultBlockAlignment, std::size_t MaxCapacity = 0>
+class FixedMemCache : private LockFreeLinkedMemCache {
+    static_assert(BlockSize > 0, "BlockSize must not be zero");
+    static_assert(isPowerOfTwo(Alignment), "Alignment must be a power of two");
+
+public:
+    using Block = FixedMemBlock<BlockSize, Alignment>;
+
+    static constexpr std::size_t slotSize{
+        blockSlotSize(blockPayloadOffset<LinkedMemBlock>(), BlockSize,
+                      (Alignment > defaultBlockAlignment) ? Alignment : defaultBlockAlignment)};
+
+    static constexpr std::size_t slabSize{
+        (MaxCapacity > 0) ? (MaxCapacity * slotSize + Alignment) : SlabAllocator::defaultSlabSize};
+
+    explicit FixedMemCache(std::size_t minFreeBlocks, PageBacking pageBacking = PageBacking::SmallPages)
+            : LockFreeLinkedMemCache{minFreeBlocks, BlockSize, Alignment, pageBacking, slabSize} {
+    }
+
+    FixedMemCache(const FixedMemCache &) = delete;
+
+    using LockFreeLinkedMemCache::upkeep;
+
+    // The acquired block goes back to this cache when it is destroyed.
+    PooledBlock<Block> acquire();
+
+    void release(PooledBlock<Block> block);
+
+    using LockFreeLinkedMemCache::getMinFreeBlocks;
+    using LockFreeLinkedMemCache::getFreeBlocksCount;
+    using LockFreeLinkedMemCache::getAllocationCount;
+    using LockFreeLinkedMemCache::getFailedAcquireCount;
+    using LockFreeLinkedMemCache::getAllocatedBlocksCount;
+    using LockFreeLinkedMemCache::getCasRetryCount;
+    using LockFreeLinkedMemCache::getEliminationCount;
+    using LockFreeLinkedMemCache::setLowWatermark;
+    using LockFreeLinkedMemCache::getLowWatermark;
+    using LockFreeLinkedMemCache::waitForUpkeepNeeded;
+    using LockFreeLinkedMemCache::getUpkeepNeededFd;
+    using LockFreeLinkedMemCache::setHighWatermark;
+    using LockFreeLinkedMemCache::getHighWatermark;
+    using LockFreeLinkedMemCache::setMaxShrinkFraction;
+    using LockFreeLinkedMemCache::getMaxShrinkFraction;
+    using LockFreeLinkedMemCache::enableAutoTuning;
+    using LockFreeLinkedMemCache::isAutoTuning;
+    using LockFreeLinkedMemCache::getMinFreeBlocksHistory;
+    using LockFreeLinkedMemCache::getSlabCount;
+    using LockFreeLinkedMemCache::getPageBacking;
+    using LockFreeLinkedMemCache::getAlignment;
+
+private:
+    LinkedMemBlock * createBlock() override;
+};
+
+template<std::size_t BlockSize, std::size_t Alignment, std::size_t MaxCapacity>
+inline PooledBlock<FixedMemBlock<BlockSize, Alignment>> FixedMemCache<BlockSize, Alignment, MaxCapacity>::acquire() {
+    // Every block in the list was made by createBlock() or came from release().
+    return PooledBlock<Block>(static_cast<Block *>(LockFreeLinkedMemCache::acquire().release()));
+}
+
+template<std::size_t BlockSize, std::size_t Alignment, std::size_t MaxCapacity>
+inline void FixedMemCache<BlockSize, Alignment, MaxCapacity>::release(PooledBlock<Block> block) {
+    LockFreeLinkedMemCache::release(std::move(block));
+}
+
+template<std::size_t BlockSize, std::size_t Alignment, std::size_t MaxCapacity>
+LinkedMemBlock * FixedMemCache<BlockSize, Alignment, MaxCapacity>::createBlock() {
+    SlabAllocator & allocator{getSlabAllocator()};
+    if ((MaxCapacity > 0) && (allocator.getLiveBlocksCount() >= MaxCapacity)) {
+        return nullptr;
+    }
+    return Block::create(allocator).release();
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <iterator>
+#include "FlatCombiningMemCache.hpp"
+
+std::atomic<std::size_t> FlatCombiningMemCache::threadCount{0};
+thread_local std::size_t FlatCombiningMemCache::threadIndex{0};
+
+FlatCombiningMemCache::FlatCombiningMemCache(std::size_t minFreeBlocks, std::size_t blockSize, std::size_t slotCount,
+                                             std::size_t alignment, PageBacking pageBacking)
+        : memCache{minFreeBlocks, blockSize, alignment, pageBacking},
+          slots(std::max<std::size_t>(1, slotCount)) {
+    // A pass serves at most one request per slot, and freeBlocks is flushed
+    // above 2 * slotCount blocks, so the combiner never allocates.
+    acquireSlots.reserve(slots.size());
+    freeBlocks.reserve(3 * slots.size());
+    surplusBlocks.reserve(3 * slots.size());
+}
+
+void FlatCombiningMemCache::upkeep() {
+    // The blocks on the stack of the combiner are free blocks too. They go
+    // back to the MemCache, so that its upkeep() sees all of them.
+    while (!tryLockCombiner()) {
+        std::this_thread::yield();
+    }
+    flushFreeBlocks(0);
+    unlockCombiner();
+
+    memCache.upkeep();
+}
+
+void FlatCombiningMemCache::combine() {
+    std::size_t requestCount{0};
+    // A request in a slot this pass misses is served by its own thread,
+    // which becomes the next combiner.
+    const std::size_t slotCount{usedSlotCount.load(std::memory_order_relaxed)};
+    for (std::size_t i{0}; i < slotCount; ++i) {
+        Slot & slot{slots[i]};
+        const Request request{slot.request.load(std::memory_order_acquire)};
+        if (request == Request::Acquire) {
+            acquireSlots.push_back(&slot);
+            ++requestCount;
+        } else if (request == Request::Release) {
+            freeBlocks.emplace_back(slot.block);
+            slot.block = nullptr;
+            slot.request.store(Request::Done, std::memory_order_release);
+            ++requestCount;
+        }
+    }
+
+    if (acquireSlots.size() > freeBlocks.size()) {
+        // Refill with a batch on top, so the next passes need no mutex.
+        memCache.acquireBatch(freeBlocks, acquireSlots.size() - freeBlocks.size() + slots.size());
+    }
+    for (Slot * slot : acquireSlots) {
+        // There may not be enough free blocks for the last ones.
+        slot->block = nullptr;
+        if (!freeBlocks.empty()) {
+            slot->block = freeBlocks.back().release();
+            freeBlocks.pop_back();
+        }
+        slot->request.store(Request::Done, std::memory_order_release);
+    }
+    acquireSlots.clear();
+    if (freeBlocks.size() > 2 * slots.size()) {
+        flushFreeBlocks(slots.size());
+    }
+    localFreeBlocksCount.store(freeBlocks.size(), std::memory_order_relaxed);
+
+    if (requestCount > 0) {
+        combineCount.fetch_add(1, std::memory_order_relaxed);
+        combinedRequestCount.fetch_add(requestCount, std::memory_order_relaxed);
+    }
+}
+
+void FlatCombiningMemCache::flushFreeBlocks(std::size_t keepCount) {
+    if (freeBlocks.size() <= keepCount) {
+        return;
+    }
+    auto first = freeBlocks.begin() + keepCount;
+    std::move(first, freeBlocks.end(), std::back_inserter(surplusBlocks));
+    freeBlocks.erase(first, freeBlocks.end());
+    localFreeBlocksCount.store(freeBlocks.size(), std::memory_order_relaxed);
+    memCache.releaseBatch(surplusBlocks);
+}
@@ -0,0 +1,229 @@
+//
+// This is a flat combining front-end over a MemCache for many user threads.
+//
+// A user thread does not take the mutex of the MemCache itself. It publishes
+// its acquire or release request in a slot and waits. Whichever waiting
+// thread wins the combiner role scans all slots and serves every pending
+// request in one pass against a stack of free blocks that only the combiner
+// touches. So under contention the free blocks stay in the cache of the
+// combining core instead of bouncing between all cores, and every other
+// thread only touches its own slot. The stack is refilled from and flushed
+// to the MemCache in batches of slotCount blocks, with one acquireBatch()
+// or releaseBatch().
+//
+// Any number of threads may use the cache. A thread starts at its home slot
+// (round robin, like StripedMemCache) and takes the next free one if that
+// is busy. A block that is only dropped goes back to the MemCache directly
+// (see PooledBlock). upkeep() flushes the stack and upkeeps the MemCache.
+// Like MemCache::upkeep() it is meant to be run periodically from one thread.
+//
+
+#ifndef FLAT_COMBINING_MEM_CACHE_HPP
+#define FLAT_COMBINING_MEM_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Backoff.hpp"
+#include "MemCache.hpp"
+
+class FlatCombiningMemCache {
+public:
+    using Block = MemBlock;
+
+    // slotCount: Number of request slots. Threads beyond it wait for a free slot.
+    FlatCombiningMemCache(std::size_t minFreeBlocks, std::size_t blockSize, std::size_t slotCount = 64,
+                          std::size_t alignment = defaultBlockAlignment,
+                          PageBacking pageBacking = PageBacking::SmallPages);
+
+    FlatCombiningMemCache(const FlatCombiningMemCache &) = delete;
+
+    virtual ~FlatCombiningMemCache() = default;
+
+    void upkeep();
+
+    // The acquired block goes back to the MemCache when it is destroyed.
+    PooledBlock<MemBlock> acquire();
+
+    // Blocks of other caches or without a cache are given back to their
+    // owner or deleted.
+    void release(PooledBlock<MemBlock> block);
+
+    std::size_t getSlotCount();
+    std::size_t getFreeBlocksCount();
+    std::size_t getAllocationCount();
+    // Combining passes and the requests served by them. Their ratio is the
+    // average number of requests a combiner served at once.
+    std::size_t getCombineCount();
+    std::size_t getCombinedRequestCount();
+    std::size_t getBlockSize();
+
+private:
+    enum class Request {
+        None,
+        // The owner thread is filling in the slot.
+        Claimed,
+        Acquire,
+        Release,
+        // The combiner served the request. block holds the acquired block.
+        Done
+    };
+
+    // The state is the only field written by both the owner thread and the
+    // combiner. block is handed over by the release/acquire on the state.
+    struct alignas(cacheLineSize) Slot {
+        std::atomic<Request> request{Request::None};
+        MemBlock * block{nullptr};
+    };
+
+    // How many times a waiting thread spins before it yields its CPU.
+    static constexpr unsigned spinCount{64};
+
+    MemCache memCache;
+    std::vector<Slot> slots;
+
+    alignas(cacheLineSize) std::atomic<bool> isCombining{false};
+    // The slots past it have never been claimed, so the combiner skips them.
+    std::atomic<std::size_t> usedSlotCount{0};
+
+    // Only touched by the combiner.
+    std::vector<Slot *> acquireSlots{};
+    std::vector<PooledBlock<MemBlock>> freeBlocks{};
+    std::vector<PooledBlock<MemBlock>> surplusBlocks{};
+
+    // Only written by the combiner.
+    std::atomic<std::size_t> localFreeBlocksCount{0};
+    std::atomic<std::size_t> combineCount{0};
+    std::atomic<std::size_t> combinedRequestCount{0};
+
+    static std::atomic<std::size_t> threadCount;
+    static thread_local std::size_t threadIndex;
+
+    static std::size_t getThreadIndex();
+
+    Slot & claimSlot();
+
+    void updateUsedSlotCount(std::size_t count);
+
+    // Publishes the request and waits until a combiner, possibly this
+    // thread, served it. Returns the acquired block.
+    MemBlock * execute(Request request, MemBlock * block);
+
+    // Takes the combiner role. Returns false if another thread has it.
+    bool tryLockCombiner();
+    void unlockCombiner();
+
+    // Serves every pending request. Call with the combiner role held.
+    void combine();
+
+    // Gives all but keepCount blocks of freeBlocks back to the MemCache.
+    // Call with the combiner role held.
+    void flushFreeBlocks(std::size_t keepCount);
+};
+
+inline std::size_t FlatCombiningMemCache::getThreadIndex() {
+    // 0 means not assigned yet.
+    if (threadIndex == 0) {
+        threadIndex = threadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    return threadIndex - 1;
+}
+
+inline FlatCombiningMemCache::Slot & FlatCombiningMemCache::claimSlot() {
+    const std::size_t homeSlotIndex{getThreadIndex() % slots.size()};
+    for (;;) {
+        for (std::size_t i{0}; i < slots.size(); ++i) {
+            Slot & slot{slots[(homeSlotIndex + i) % slots.size()]};
+            Request none{Request::None};
+            if (slot.request.load(std::memory_order_relaxed) == Request::None
+                && slot.request.compare_exchange_strong(none, Request::Claimed,
+                                                        std::memory_order_acquire, std::memory_order_relaxed)) {
+                updateUsedSlotCount((homeSlotIndex + i) % slots.size() + 1);
+                return slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+inline void FlatCombiningMemCache::updateUsedSlotCount(std::size_t count) {
+    std::size_t current{usedSlotCount.load(std::memory_order_relaxed)};
+    while (current < count && !usedSlotCount.compare_exchange_weak(current, count, std::memory_order_relaxed)) {
+        // Nothing
+    }
+}
+
+inline bool FlatCombiningMemCache::tryLockCombiner() {
+    return !isCombining.load(std::memory_order_relaxed) && !isCombining.exchange(true, std::memory_order_acquire);
+}
+
+inline void FlatCombiningMemCache::unlockCombiner() {
+    isCombining.store(false, std::memory_order_release);
+}
+
+inline MemBlock * FlatCombiningMemCache::execute(Request request, MemBlock * block) {
+    Slot & slot{claimSlot()};
+    slot.block = block;
+    slot.request.store(request, std::memory_order_release);
+
+    unsigned spins{0};
+    while (slot.request.load(std::memory_order_acquire) != Request::Done) {
+        if (tryLockCombiner()) {
+            combine();
+            unlockCombiner();
+        } else if (++spins < spinCount) {
+            cpuRelax();
+        } else {
+            // The combiner may be waiting for this CPU.
+            spins = 0;
+            std::this_thread::yield();
+        }
+    }
+
+    MemBlock * acquiredBlock{slot.block};
+    slot.request.store(Request::None, std::memory_order_release);
+    return acquiredBlock;
+}
+
+inline PooledBlock<MemBlock> FlatCombiningMemCache::acquire() {
+    return PooledBlock<MemBlock>{execute(Request::Acquire, nullptr)};
+}
+
+inline void FlatCombiningMemCache::release(PooledBlock<MemBlock> block) {
+    if (block == nullptr) {
+        return;
+    }
+    auto owner = static_cast<MemCache *>(block->getOwner());
+    if (owner != &memCache) {
+        return;
+    }
+    execute(Request::Release, block.release());
+}
+
+inline std::size_t FlatCombiningMemCache::getSlotCount() {
+    return slots.size();
+}
+
+inline std::size_t FlatCombiningMemCache::getFreeBlocksCount() {
+    return memCache.getFreeBlocksCount() + localFreeBlocksCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t FlatCombiningMemCache::getAllocationCount() {
+    return memCache.getAllocationCount();
+}
+
+inline std::size_t FlatCombiningMemCache::getCombineCount() {
+    return combineCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t FlatCombiningMemCache::getCombinedRequestCount() {
+    return combinedRequestCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t FlatCombiningMemCache::getBlockSize() {
+    return memCache.getBlockSize();
+}
+
+#endif
@@ -2,9 +2,30 @@
 // Created by feher on 1.8.2018.
 //
 
+#include <new>
 #include "LinkedMemBlock.hpp"
 
-LinkedMemBlock::LinkedMemBlock(std::size_t blockSize)
-    : data{std::unique_ptr<uint8_t[]>(new uint8_t[blockSize])} {
+std::unique_ptr<LinkedMemBlock> LinkedMemBlock::create(std::size_t blockSize) {
+    void * memory{::operator new(blockPayloadOffset<LinkedMemBlock>() + blockSize)};
+    return std::unique_ptr<LinkedMemBlock>(::new (memory) LinkedMemBlock{nullptr});
 }
 
+std::unique_ptr<LinkedMemBlock> LinkedMemBlock::create(SlabAllocator & allocator) {
+    Slab * slab;
+    void * memory{allocator.allocate(slab)};
+    return std::unique_ptr<LinkedMemBlock>(::new (memory) LinkedMemBlock{slab});
+}
+
+LinkedMemBlock * LinkedMemBlock::createIn(void * memory) {
+    return ::new (memory) LinkedMemBlock{nullptr};
+}
+
+void LinkedMemBlock::operator delete(void * memory) {
+    // The destructor is trivial, so the header is still readable here.
+    Slab * slab{static_cast<LinkedMemBlock *>(memory)->slab};
+    if (slab != nullptr) {
+        SlabAllocator::deallocate(slab, memory);
+    } else {
+        ::operator delete(memory);
+    }
+}
@@ -5,27 +5,76 @@
 #ifndef LINKED_MEM_BLOCK_HPP
 #define LINKED_MEM_BLOCK_HPP
 
+#include <cassert>
+#include <atomic>
 #include <memory>
 #include <cstdint>
+#include "BlockLayout.hpp"
+#include "SlabAllocator.hpp"
 
+class LockFreeLinkedMemCache;
+
+// The header and the payload of the block live in one allocation.
+// The payload follows the header at blockPayloadOffset<LinkedMemBlock>().
+// getAs<T>() checks in debug builds that the payload is aligned for T.
+// Derived blocks (see FixedMemBlock) must not add members.
 struct LinkedMemBlock {
-    LinkedMemBlock * next{nullptr};
+    // Atomic because a thread popping the block may read it while the
+    // thread that popped the block first relinks it. See LockFreeLinkedList.
+    std::atomic<LinkedMemBlock *> next{nullptr};
+
+    // The type of the cache that owns the block. See PooledBlock.
+    using Owner = LockFreeLinkedMemCache;
 
-    std::unique_ptr<uint8_t[]> data{nullptr};
+    // The slab the block was carved from. nullptr if the block was
+    // allocated on its own.
+    Slab * slab{nullptr};
 
     LinkedMemBlock(const LinkedMemBlock &) = delete;
 
-    explicit LinkedMemBlock(std::size_t blockSize);
+    ~LinkedMemBlock() = default;
+
+    static std::unique_ptr<LinkedMemBlock> create(std::size_t blockSize);
 
-    virtual ~LinkedMemBlock() = default;
+    static std::unique_ptr<LinkedMemBlock> create(SlabAllocator & allocator);
+
+    // Makes an ownerless block in memory that belongs to someone else (see
+    // PoolMemoryResource). Such a block must not be deleted.
+    static LinkedMemBlock * createIn(void * memory);
 
     template<typename T>
     T * getAs();
+
+    // The block whose payload starts at payload, i.e. the inverse of getAs().
+    static LinkedMemBlock * fromPayload(void * payload);
+
+    // The cache whose slab the block was carved from.
+    // nullptr if the block was allocated on its own or its cache is gone.
+    void * getOwner() const;
+
+    // Blocks can only be made by create(). A plain new would not reserve
+    // room for the payload.
+    // Deleting a block gives its memory back to its slab (if any).
+    static void * operator new(std::size_t) = delete;
+    static void operator delete(void * memory);
+
+protected:
+    explicit LinkedMemBlock(Slab * slab) : slab{slab} {}
 };
 
+inline LinkedMemBlock * LinkedMemBlock::fromPayload(void * payload) {
+    return reinterpret_cast<LinkedMemBlock *>(static_cast<uint8_t *>(payload) - blockPayloadOffset<LinkedMemBlock>());
+}
+
+inline void * LinkedMemBlock::getOwner() const {
+    return (slab != nullptr) ? slab->owner : nullptr;
+}
+
 template<typename T>
 T * LinkedMemBlock::getAs() {
-    return reinterpret_cast<T *>(data.get());
+    uint8_t * payload{reinterpret_cast<uint8_t *>(this) + blockPayloadOffset<LinkedMemBlock>()};
+    assert(reinterpret_cast<std::uintptr_t>(payload) % alignof(T) == 0);
+    return reinterpret_cast<T *>(payload);
 }
 
 #endif
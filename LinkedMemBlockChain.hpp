@@ -0,0 +1,135 @@
+//
+// Owns a chain of LinkedMemBlocks linked through their next pointers.
+// Used to move many blocks in and out of a LockFreeLinkedList at once.
+// The blocks still in the chain go back to their cache when the chain is
+// destroyed (see PooledBlock).
+//
+
+#ifndef LINKED_MEM_BLOCK_CHAIN_HPP
+#define LINKED_MEM_BLOCK_CHAIN_HPP
+
+#include <cstddef>
+#include <memory>
+#include "LinkedMemBlock.hpp"
+#include "PooledBlock.hpp"
+
+class LinkedMemBlockChain {
+public:
+    LinkedMemBlockChain() = default;
+
+    // Takes over the blocks from first to last. last->next must be nullptr.
+    LinkedMemBlockChain(LinkedMemBlock * first, LinkedMemBlock * last, std::size_t length);
+
+    LinkedMemBlockChain(const LinkedMemBlockChain &) = delete;
+
+    LinkedMemBlockChain(LinkedMemBlockChain && other) noexcept;
+
+    LinkedMemBlockChain & operator=(LinkedMemBlockChain && other) noexcept;
+
+    virtual ~LinkedMemBlockChain();
+
+    void pushToFront(PooledBlock<LinkedMemBlock> block);
+
+    PooledBlock<LinkedMemBlock> popFromFront();
+
+    LinkedMemBlock * getFirst();
+    LinkedMemBlock * getLast();
+    std::size_t getLength();
+    bool isEmpty();
+
+    // Gives up the ownership of the blocks and returns the first one.
+    LinkedMemBlock * release();
+
+private:
+    LinkedMemBlock * first{nullptr};
+    LinkedMemBlock * last{nullptr};
+    std::size_t length{0};
+
+    void clear();
+};
+
+inline LinkedMemBlockChain::LinkedMemBlockChain(LinkedMemBlock * first, LinkedMemBlock * last, std::size_t length)
+        : first{first},
+          last{last},
+          length{length} {
+}
+
+inline LinkedMemBlockChain::LinkedMemBlockChain(LinkedMemBlockChain && other) noexcept
+        : first{other.first},
+          last{other.last},
+          length{other.length} {
+    other.release();
+}
+
+inline LinkedMemBlockChain & LinkedMemBlockChain::operator=(LinkedMemBlockChain && other) noexcept {
+    if (this != &other) {
+        clear();
+        first = other.first;
+        last = other.last;
+        length = other.length;
+        other.release();
+    }
+    return *this;
+}
+
+inline LinkedMemBlockChain::~LinkedMemBlockChain() {
+    clear();
+}
+
+inline void LinkedMemBlockChain::pushToFront(PooledBlock<LinkedMemBlock> block) {
+    if (block == nullptr) {
+        return;
+    }
+    block->next.store(first, std::memory_order_relaxed);
+    first = block.release();
+    if (last == nullptr) {
+        last = first;
+    }
+    ++length;
+}
+
+inline PooledBlock<LinkedMemBlock> LinkedMemBlockChain::popFromFront() {
+    if (first == nullptr) {
+        return nullptr;
+    }
+    PooledBlock<LinkedMemBlock> block{first};
+    first = first->next.load(std::memory_order_relaxed);
+    if (first == nullptr) {
+        last = nullptr;
+    }
+    --length;
+    block->next.store(nullptr, std::memory_order_relaxed);
+    return block;
+}
+
+inline LinkedMemBlock * LinkedMemBlockChain::getFirst() {
+    return first;
+}
+
+inline LinkedMemBlock * LinkedMemBlockChain::getLast() {
+    return last;
+}
+
+inline std::size_t LinkedMemBlockChain::getLength() {
+    return length;
+}
+
+inline bool LinkedMemBlockChain::isEmpty() {
+    return first == nullptr;
+}
+
+inline LinkedMemBlock * LinkedMemBlockChain::release() {
+    LinkedMemBlock * chain{first};
+    first = nullptr;
+    last = nullptr;
+    length = 0;
+    return chain;
+}
+
+inline void LinkedMemBlockChain::clear() {
+    while (popFromFront() != nullptr) {
+        // Nothing
+    }
+}
+
+#endif
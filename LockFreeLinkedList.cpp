@@ -2,8 +2,17 @@
 // Created by gabor on 1.8.2018.
 //
 
+#include <cstdio>
+#include <cstdlib>
 #include "LockFreeLinkedList.hpp"
 
+void LockFreeLinkedList::failUntaggablePointer(const LinkedMemBlock * item) {
+    // Packing the pointer would lose bits and break the list later, far from here.
+    std::fprintf(stderr, "LockFreeLinkedList: Block %p is not 16 byte aligned or above 2^48\n",
+                 static_cast<const void *>(item));
+    std::abort();
+}
+
 LockFreeLinkedList::~LockFreeLinkedList() {
     LinkedMemBlock * freeBlock;
     while ((freeBlock = popFromFront()) != nullptr) {
@@ -12,8 +21,9 @@ LockFreeLinkedList::~LockFreeLinkedList() {
 }
 
 std::size_t LockFreeLinkedList::calculateLength() {
+    EpochReclamation::Guard guard{};
     std::size_t len{0};
-    for (LinkedMemBlock * item{head.load()}; item != nullptr ; item = item->next, ++len) {
+    for (LinkedMemBlock * item{getHead()}; item != nullptr ; item = item->next.load(std::memory_order_relaxed), ++len) {
         // Nothing
     }
     return len;
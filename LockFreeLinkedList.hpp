@@ -7,11 +7,78 @@
 
 #include <cstdint>
 #include <atomic>
+#include "Backoff.hpp"
+#include "BlockLayout.hpp"
+#include "EpochReclamation.hpp"
 #include "LinkedMemBlock.hpp"
 
+// A Treiber stack of LinkedMemBlocks. Any number of threads may push and pop.
+//
+// The head carries a generation tag next to the pointer. Every change of the
+// head bumps the tag, so a pop that read head A and A->next B cannot succeed
+// after other threads popped A, popped B and pushed A back (the ABA problem).
+//
+// The head stays one machine word, so plain loads and single-word CAS are
+// enough (a double-word CAS goes through libatomic with GCC). Blocks are
+// aligned to 16 bytes and user space pointers on x86-64 and AArch64 use at
+// most 48 bits, so the pointer is packed into the low 44 bits and the tag
+// gets the upper 20 bits. A pop only goes wrong if 1048576 other changes
+// happen between its load and its CAS. A pointer that does not fit (e.g. a
+// 57 bit address with 5-level paging, or a tagged pointer with AArch64 TBI
+// or MTE) aborts the process, in release builds too.
+//
+// Popping reads item->next of an item that another thread may pop (and
+// delete) at the same time. So the pops and calculateLength() run inside an
+// EpochReclamation::Guard, and an unlinked item may only be deleted when
+// EpochReclamation says it is safe (see LockFreeLinkedMemCache::shrink()).
+//
+// Under contention a failed CAS on the head backs off exponentially (see
+// Backoff). A push and a pop that both failed may also meet in the
+// elimination array: the push offers its item in a slot for a short while
+// and the pop takes it from there, so neither touches the head again.
+// getCasRetryCount() and getEliminationCount() show how often that happens.
 class LockFreeLinkedList {
 private:
-    std::atomic<LinkedMemBlock *> head{nullptr};
+    static_assert(sizeof(std::uintptr_t) == 8, "The tagged head needs 64 bit pointers");
+
+    static_assert(defaultBlockAlignment >= 16, "The tagged head needs 16 byte aligned blocks");
+
+    // The pointer is stored shifted right by pointerShift.
+    static constexpr unsigned pointerShift{4};
+    static constexpr unsigned tagShift{44};
+    static constexpr std::uintptr_t pointerMask{(std::uintptr_t{1} << tagShift) - 1};
+
+    static constexpr unsigned eliminationSlotCount{8};
+    // How many times a push checks its slot before it takes the item back.
+    static constexpr unsigned eliminationWaitCount{64};
+
+    // A slot holds an offered item or nullptr. Slots are on their own cache
+    // lines, so the threads meeting in one slot do not disturb the others.
+    struct alignas(cacheLineSize) EliminationSlot {
+        std::atomic<LinkedMemBlock *> item{nullptr};
+    };
+
+    std::atomic<std::uintptr_t> head{0};
+
+    alignas(cacheLineSize) std::atomic<std::size_t> casRetryCount{0};
+    std::atomic<std::size_t> eliminationCount{0};
+
+    EliminationSlot eliminationSlots[eliminationSlotCount]{};
+
+    static LinkedMemBlock * getPointer(std::uintptr_t taggedHead);
+
+    [[noreturn]] static void failUntaggablePointer(const LinkedMemBlock * item);
+
+    // Packs item with the tag following the tag of previousHead.
+    static std::uintptr_t makeNextHead(LinkedMemBlock * item, std::uintptr_t previousHead);
+
+    static EliminationSlot & pickEliminationSlot(EliminationSlot * slots);
+
+    // Returns true if a pop took the item.
+    bool offerForElimination(LinkedMemBlock * item);
+
+    // Returns an item offered by a push, or nullptr.
+    LinkedMemBlock * takeFromElimination();
 
 public:
     LockFreeLinkedList() = default;
@@ -29,51 +96,204 @@ public:
     void pushToFront(LinkedMemBlock * item);
 
     LinkedMemBlock * popFromFront();
+
+    // Splices the chain from first to last in front of the list with one CAS.
+    void pushChainToFront(LinkedMemBlock * first, LinkedMemBlock * last);
+
+    // Unlinks at most count items from the front with one CAS.
+    // Returns the first unlinked item. last and length describe the chain.
+    LinkedMemBlock * popChainFromFront(std::size_t count, LinkedMemBlock *& last, std::size_t & length);
+
+    // Failed CAS attempts on the head.
+    std::size_t getCasRetryCount();
+
+    // Items handed from a push to a pop through the elimination array.
+    std::size_t getEliminationCount();
 };
 
-inline LockFreeLinkedList::LockFreeLinkedList(LinkedMemBlock * head) : head{head} {
+inline LockFreeLinkedList::LockFreeLinkedList(LinkedMemBlock * head) : head{makeNextHead(head, 0)} {
 
 }
 
+inline LinkedMemBlock * LockFreeLinkedList::getPointer(std::uintptr_t taggedHead) {
+    return reinterpret_cast<LinkedMemBlock *>((taggedHead & pointerMask) << pointerShift);
+}
+
+inline std::uintptr_t LockFreeLinkedList::makeNextHead(LinkedMemBlock * item, std::uintptr_t previousHead) {
+    const std::uintptr_t pointer{reinterpret_cast<std::uintptr_t>(item)};
+    if ((pointer & ~(pointerMask << pointerShift)) != 0) {
+        failUntaggablePointer(item);
+    }
+    // The tag wraps around by overflowing out of the word.
+    return ((previousHead & ~pointerMask) + (std::uintptr_t{1} << tagShift)) | (pointer >> pointerShift);
+}
+
 inline LinkedMemBlock * LockFreeLinkedList::exchangeHead(LinkedMemBlock * newHead) {
-    return head.exchange(newHead);
+    std::uintptr_t current{head.load(std::memory_order_acquire)};
+    while (!head.compare_exchange_weak(current, makeNextHead(newHead, current),
+                                       std::memory_order_acq_rel, std::memory_order_acquire)) {
+        // Nothing
+    }
+    return getPointer(current);
 }
 
 inline LinkedMemBlock * LockFreeLinkedList::getHead() {
-    return head.load();
+    return getPointer(head.load(std::memory_order_acquire));
 }
 
 inline void LockFreeLinkedList::pushToFront(LinkedMemBlock * item) {
     if (item == nullptr) {
         return;
     }
-    item->next = head.load();
-
-    // Note: If pushToFront() and popFromFront() are always called from
-    // the same thread then head.store(item) would be enough.
+    std::uintptr_t current{head.load(std::memory_order_relaxed)};
+    Backoff backoff{};
 
     // This does: head = item
-    while (!head.compare_exchange_weak(item->next, item)) {
-        // Nothing
+    for (;;) {
+        item->next.store(getPointer(current), std::memory_order_relaxed);
+        if (head.compare_exchange_weak(current, makeNextHead(item, current),
+                                       std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+        casRetryCount.fetch_add(1, std::memory_order_relaxed);
+        if (offerForElimination(item)) {
+            return;
+        }
+        backoff.pause();
+        current = head.load(std::memory_order_relaxed);
     }
 }
 
 inline LinkedMemBlock * LockFreeLinkedList::popFromFront() {
-    LinkedMemBlock * item{head.load()};
-
-    // Note: If pushToFront() and popFromFront() are always called from
-    // the same thread then we can head.store(item->next) would be enough.
+    EpochReclamation::Guard guard{};
+    std::uintptr_t current{head.load(std::memory_order_acquire)};
+    Backoff backoff{};
 
     // This does: head = item->next
-    while (item && !head.compare_exchange_weak(item, item->next)) {
-        // Nothing
+    // item->next may be stale if another thread popped item meanwhile,
+    // but then the tag has changed and the CAS fails.
+    for (;;) {
+        LinkedMemBlock * item{getPointer(current)};
+        if (item == nullptr) {
+            return nullptr;
+        }
+        if (head.compare_exchange_weak(current, makeNextHead(item->next.load(std::memory_order_relaxed), current),
+                                       std::memory_order_acq_rel, std::memory_order_acquire)) {
+            item->next.store(nullptr, std::memory_order_relaxed);
+            return item;
+        }
+        casRetryCount.fetch_add(1, std::memory_order_relaxed);
+        item = takeFromElimination();
+        if (item != nullptr) {
+            item->next.store(nullptr, std::memory_order_relaxed);
+            return item;
+        }
+        backoff.pause();
+        current = head.load(std::memory_order_acquire);
     }
+}
 
-    if (item == nullptr) {
+inline void LockFreeLinkedList::pushChainToFront(LinkedMemBlock * first, LinkedMemBlock * last) {
+    if (first == nullptr) {
+        return;
+    }
+    std::uintptr_t current{head.load(std::memory_order_relaxed)};
+    Backoff backoff{};
+
+    // This does: head = first
+    // The release publishes the chain (and the payloads) to the popping threads.
+    for (;;) {
+        last->next.store(getPointer(current), std::memory_order_relaxed);
+        if (head.compare_exchange_weak(current, makeNextHead(first, current),
+                                       std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+        casRetryCount.fetch_add(1, std::memory_order_relaxed);
+        backoff.pause();
+        current = head.load(std::memory_order_relaxed);
+    }
+}
+
+inline LinkedMemBlock * LockFreeLinkedList::popChainFromFront(std::size_t count, LinkedMemBlock *& last,
+                                                               std::size_t & length) {
+    EpochReclamation::Guard guard{};
+    std::uintptr_t current{head.load(std::memory_order_acquire)};
+    Backoff backoff{};
+    last = nullptr;
+    length = 0;
+    if (count == 0) {
+        return nullptr;
+    }
+
+    // This does: head = last->next
+    for (;;) {
+        LinkedMemBlock * first{getPointer(current)};
+        if (first == nullptr) {
+            last = nullptr;
+            length = 0;
+            return nullptr;
+        }
+        last = first;
+        length = 1;
+        LinkedMemBlock * rest{last->next.load(std::memory_order_relaxed)};
+        while (length < count && rest != nullptr) {
+            last = rest;
+            rest = last->next.load(std::memory_order_relaxed);
+            ++length;
+        }
+        if (head.compare_exchange_weak(current, makeNextHead(rest, current),
+                                       std::memory_order_acq_rel, std::memory_order_acquire)) {
+            last->next.store(nullptr, std::memory_order_relaxed);
+            return first;
+        }
+        casRetryCount.fetch_add(1, std::memory_order_relaxed);
+        backoff.pause();
+        current = head.load(std::memory_order_acquire);
+    }
+}
+
+inline LockFreeLinkedList::EliminationSlot & LockFreeLinkedList::pickEliminationSlot(EliminationSlot * slots) {
+    // Threads that keep colliding on one slot move on to the next one.
+    thread_local unsigned slotIndex{0};
+    return slots[slotIndex++ % eliminationSlotCount];
+}
+
+inline bool LockFreeLinkedList::offerForElimination(LinkedMemBlock * item) {
+    EliminationSlot & slot{pickEliminationSlot(eliminationSlots)};
+    LinkedMemBlock * empty{nullptr};
+    if (!slot.item.compare_exchange_strong(empty, item, std::memory_order_release, std::memory_order_relaxed)) {
+        return false;
+    }
+    for (unsigned i{0}; i < eliminationWaitCount; ++i) {
+        if (slot.item.load(std::memory_order_relaxed) != item) {
+            return true;
+        }
+        cpuRelax();
+    }
+    // If a pop took it meanwhile, taking it back fails. If the same item has
+    // been offered again since, taking it back is still right: the pop gave
+    // it up and it must end up in the list once.
+    LinkedMemBlock * offered{item};
+    return !slot.item.compare_exchange_strong(offered, nullptr, std::memory_order_relaxed);
+}
+
+inline LinkedMemBlock * LockFreeLinkedList::takeFromElimination() {
+    EliminationSlot & slot{pickEliminationSlot(eliminationSlots)};
+    LinkedMemBlock * item{slot.item.load(std::memory_order_relaxed)};
+    if (item == nullptr
+        || !slot.item.compare_exchange_strong(item, nullptr, std::memory_order_acquire, std::memory_order_relaxed)) {
         return nullptr;
     }
-    item->next = nullptr;
+    eliminationCount.fetch_add(1, std::memory_order_relaxed);
     return item;
 }
 
+inline std::size_t LockFreeLinkedList::getCasRetryCount() {
+    return casRetryCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t LockFreeLinkedList::getEliminationCount() {
+    return eliminationCount.load(std::memory_order_relaxed);
+}
+
 #endif
@@ -2,51 +2,182 @@
 // Created by gabor on 1.8.2018.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
 #include "LockFreeLinkedMemCache.hpp"
 
+LockFreeLinkedMemCache::~LockFreeLinkedMemCache() {
+    // Nobody may use the cache any more, so nobody can read the retired blocks.
+    for (const RetiredChain & chain : retiredChains) {
+        deleteChain(chain.first);
+    }
+}
+
 void LockFreeLinkedMemCache::upkeep() {
-    // We replace the freeBlocks list with an empty temporary list.
-    // The user thread will use this new list to release() blocks to it
-    // and to acquire() blocks from it.
-    // When upkeep() is finished we discard this list. It's OK to do
-    // because it has only free blocks.
+    // The user threads keep acquiring and releasing while we work, so the
+    // count is a snapshot. It is a counter, the list is not walked.
+    // grow() and shrink() only splice whole chains in and out of the shared
+    // list, with one CAS each. The user threads always see every free block;
+    // there is no window in which the list is empty.
+    auto count = getFreeBlocksCount();
+    if (tuner.isEnabled()) {
+        tune(count);
+    }
+    const std::size_t target{getMinFreeBlocks()};
+    if (count < target) {
+        grow(target - count);
+    } else if (count > std::max(target, getHighWatermark())) {
+        shrink(getShrinkCount(count, target));
+    }
+    upkeptFreeBlocksCount = getFreeBlocksCount();
+
+    reclaimRetiredBlocks();
+}
 
-    LinkedMemBlock * tempListHead{nullptr};
-    LinkedMemBlock * freeBlocksListHead{freeBlocks.exchangeHead(tempListHead)};
-    LockFreeLinkedList freeBlocksList{freeBlocksListHead};
+void LockFreeLinkedMemCache::enableAutoTuning(std::size_t floor, std::size_t ceiling) {
+    tuner.enable(floor, ceiling, getMinFreeBlocks());
+}
 
-    auto freeBlocksCount = freeBlocksList.calculateLength();
-    if (freeBlocksCount < minFreeBlocks) {
-        grow(freeBlocksList, minFreeBlocks - freeBlocksCount);
-    } else if (freeBlocksCount > minFreeBlocks) {
-        shrink(freeBlocksList, freeBlocksCount - minFreeBlocks);
+void LockFreeLinkedMemCache::setMaxShrinkFraction(double maxShrinkFraction) {
+    if (!(maxShrinkFraction > 0.0 && maxShrinkFraction <= 1.0)) {
+        throw std::invalid_argument("LockFreeLinkedMemCache: maxShrinkFraction must be in (0, 1]");
     }
+    this->maxShrinkFraction.store(maxShrinkFraction, std::memory_order_relaxed);
+}
 
-    freeBlocks.exchangeHead(freeBlocksList.getHead());
+std::size_t LockFreeLinkedMemCache::getShrinkCount(std::size_t count, std::size_t target) {
+    // At least one block, so that the surplus always drains.
+    const double surplusCount{static_cast<double>(count - target)};
+    const auto shrinkCount = static_cast<std::size_t>(std::ceil(surplusCount * getMaxShrinkFraction()));
+    return std::max<std::size_t>(shrinkCount, 1);
+}
 
-    // Use freeBlocksList's destructor to discard the temporary list.
-    freeBlocksList.exchangeHead(tempListHead);
+void LockFreeLinkedMemCache::tune(std::size_t count) {
+    // The blocks acquired since the last upkeep(), net of the released ones.
+    const std::size_t acquiredBlocksCount{(upkeptFreeBlocksCount > count) ? upkeptFreeBlocksCount - count : 0};
+    const std::size_t failedCount{getFailedAcquireCount()};
+    const std::size_t target{tuner.update(acquiredBlocksCount, failedCount - upkeptFailedAcquireCount)};
+    upkeptFailedAcquireCount = failedCount;
+    minFreeBlocks.store(target, std::memory_order_relaxed);
+    setLowWatermark(target / 2);
 }
 
-void LockFreeLinkedMemCache::grow(LockFreeLinkedList & list, std::size_t blockCount) {
-    ++growCount;
+void LockFreeLinkedMemCache::grow(std::size_t blockCount) {
+    growCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Build the new blocks as a private chain and publish them at once.
+    LinkedMemBlockChain chain{};
     for (std::size_t i{0}; i < blockCount; ++i) {
-        list.pushToFront(new LinkedMemBlock{blockSize});
+        LinkedMemBlock * block{createBlock()};
+        if (block == nullptr) {
+            break;
+        }
+        chain.pushToFront(PooledBlock<LinkedMemBlock>(block));
+    }
+    releaseBatch(std::move(chain));
+}
+
+PooledBlock<LinkedMemBlock> LockFreeLinkedMemCache::acquireFor(std::chrono::nanoseconds timeout) {
+    PooledBlock<LinkedMemBlock> block{acquire()};
+    if (block != nullptr || timeout <= std::chrono::nanoseconds::zero()) {
+        return block;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    WaitQueue::Waiter waiter{blockWaiters};
+    for (;;) {
+        const std::uint32_t ticket{waiter.getTicket()};
+        block = acquire();
+        if (block != nullptr) {
+            return block;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return nullptr;
+        }
+        // The releasing threads increment the counter (seq_cst) before they
+        // push and check for waiters after it. So if the counter is 0 here,
+        // every later release sees this waiter and changes the ticket.
+        // Otherwise a block is on its way, or was just taken by another thread.
+        if (freeBlocksCount.load(std::memory_order_seq_cst) == 0) {
+            waiter.wait(ticket, deadline - now);
+        } else {
+            std::this_thread::yield();
+        }
     }
 }
 
-void LockFreeLinkedMemCache::shrink(LockFreeLinkedList & list, std::size_t blockCount) {
-    for (; blockCount > 0; --blockCount) {
-        LinkedMemBlock * freeBlock = list.popFromFront();
-        delete freeBlock;
+void LockFreeLinkedMemCache::shrink(std::size_t blockCount) {
+    LinkedMemBlock * last;
+    std::size_t length;
+    LinkedMemBlock * first{freeBlocks.popChainFromFront(blockCount, last, length)};
+    freeBlocksCount.fetch_sub(length, std::memory_order_relaxed);
+    if (first == nullptr) {
+        return;
+    }
+
+    // The user threads may have acquired blocks since upkeep() counted them.
+    // Never leave fewer than minFreeBlocks behind, or acquire() could fail
+    // because of upkeep().
+    const std::size_t count{getFreeBlocksCount()};
+    const std::size_t target{getMinFreeBlocks()};
+    if (count < target) {
+        const std::size_t giveBackCount{std::min(length, target - count)};
+        LinkedMemBlock * giveBackLast{first};
+        for (std::size_t i{1}; i < giveBackCount; ++i) {
+            giveBackLast = giveBackLast->next.load(std::memory_order_relaxed);
+        }
+        LinkedMemBlock * rest{giveBackLast->next.load(std::memory_order_relaxed)};
+        giveBackLast->next.store(nullptr, std::memory_order_relaxed);
+        freeBlocksCount.fetch_add(giveBackCount, std::memory_order_seq_cst);
+        freeBlocks.pushChainToFront(first, giveBackLast);
+        blockWaiters.notifyAll();
+        first = rest;
+        length -= giveBackCount;
+        if (first == nullptr) {
+            return;
+        }
     }
+
+    // A user thread may still be reading the next pointer of these blocks.
+    retiredChains.push_back(RetiredChain{first, length, EpochReclamation::getRetireEpoch()});
+    retiredBlocksCount.store(retiredBlocksCount.load(std::memory_order_relaxed) + length,
+                             std::memory_order_relaxed);
 }
 
-std::unique_ptr<LinkedMemBlock> LockFreeLinkedMemCache::acquire() {
-    return std::unique_ptr<LinkedMemBlock>(freeBlocks.popFromFront());
+void LockFreeLinkedMemCache::reclaimRetiredBlocks() {
+    if (retiredChains.empty()) {
+        return;
+    }
+
+    // Without user threads inside a guard the epoch advances twice right away,
+    // so the blocks retired by this upkeep() are deleted by it too.
+    EpochReclamation::tryAdvance();
+    EpochReclamation::tryAdvance();
+
+    auto isReclaimable = [this](const RetiredChain & chain) {
+        if (!EpochReclamation::isSafeToDelete(chain.retireEpoch)) {
+            return false;
+        }
+        deleteChain(chain.first);
+        retiredBlocksCount.store(retiredBlocksCount.load(std::memory_order_relaxed) - chain.length,
+                                 std::memory_order_relaxed);
+        return true;
+    };
+    retiredChains.erase(std::remove_if(retiredChains.begin(), retiredChains.end(), isReclaimable),
+                        retiredChains.end());
 }
 
-void LockFreeLinkedMemCache::release(std::unique_ptr<LinkedMemBlock> block) {
-    freeBlocks.pushToFront(block.release());
+void LockFreeLinkedMemCache::deleteChain(LinkedMemBlock * first) {
+    while (first != nullptr) {
+        LinkedMemBlock * next{first->next.load(std::memory_order_relaxed)};
+        delete first;
+        first = next;
+    }
 }
 
+LinkedMemBlock * LockFreeLinkedMemCache::createBlock() {
+    return LinkedMemBlock::create(*allocator).release();
+}
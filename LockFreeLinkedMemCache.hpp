@@ -5,49 +5,351 @@
 #ifndef LOCK_FREE_LINKED_MEM_CACHE_HPP
 #define LOCK_FREE_LINKED_MEM_CACHE_HPP
 
+#include <atomic>
+#include <cmath>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EpochReclamation.hpp"
+#include "LinkedMemBlockChain.hpp"
 #include "LockFreeLinkedList.hpp"
+#include "MinFreeBlocksTuner.hpp"
+#include "PooledBlock.hpp"
+#include "UpkeepSignal.hpp"
+#include "WaitQueue.hpp"
 
 // This is a lock free implementation of the memory cache.
 // It uses a singly linked list to manage the free blocks.
+//
+// upkeep() works on the shared list while the user threads acquire and
+// release. Surplus blocks are unlinked with one CAS and deleted only when no
+// user thread can still be reading them (see EpochReclamation).
 
 class LockFreeLinkedMemCache {
 public:
-    LockFreeLinkedMemCache(std::size_t minFreeBlocks, std::size_t blockSize)
-            : minFreeBlocks{minFreeBlocks},
-              blockSize{blockSize} {
+    using Block = LinkedMemBlock;
+
+    // alignment: Alignment of every block's payload. A power of two.
+    //   E.g. 64 keeps blocks off each other's cache lines, 4096 gives
+    //   page aligned blocks.
+    // pageBacking: The preferred backing of the block memory.
+    //   See getPageBacking() for the backing that was actually got.
+    LockFreeLinkedMemCache(std::size_t minFreeBlocks, std::size_t blockSize,
+                           std::size_t alignment = defaultBlockAlignment,
+                           PageBacking pageBacking = PageBacking::SmallPages)
+            : LockFreeLinkedMemCache{minFreeBlocks, blockSize, alignment, pageBacking,
+                                     SlabAllocator::defaultSlabSize} {
     }
 
     LockFreeLinkedMemCache(const LockFreeLinkedMemCache &) = delete;
 
-    virtual ~LockFreeLinkedMemCache() = default;
+    virtual ~LockFreeLinkedMemCache();
 
     void upkeep();
 
-    std::unique_ptr<LinkedMemBlock> acquire();
+    // The acquired block goes back to this cache when it is destroyed.
+    PooledBlock<LinkedMemBlock> acquire();
+
+    // Like acquire(), but if there is no free block it sleeps until
+    // release() or upkeep() gives one back, or until timeout.
+    // Returns nullptr on timeout.
+    PooledBlock<LinkedMemBlock> acquireFor(std::chrono::nanoseconds timeout);
+
+    void release(PooledBlock<LinkedMemBlock> block);
+
+    // Acquires at most count blocks with one CAS.
+    LinkedMemBlockChain acquireBatch(std::size_t count);
+
+    // Releases every block of the chain with one CAS.
+    void releaseBatch(LinkedMemBlockChain chain);
+
+    // Gives the block back to the cache that carved it. Used by PooledBlock.
+    static void releaseToOwner(LinkedMemBlock * block);
+
+    // acquire() and acquireBatch() signal that upkeep() is needed when they
+    // leave fewer than lowWatermark free blocks or find too few.
+    // minFreeBlocks / 2 by default.
+    void setLowWatermark(std::size_t lowWatermark);
+    std::size_t getLowWatermark();
+
+    // Sleeps until upkeep() is needed (see setLowWatermark()) or until timeout.
+    // Returns false on timeout. Meant for the thread that calls upkeep().
+    bool waitForUpkeepNeeded(std::chrono::nanoseconds timeout);
+
+    // An eventfd for epoll loops, readable when upkeep() is needed. Then call
+    // waitForUpkeepNeeded(0) to clear it, and upkeep(). It may be readable spuriously.
+    int getUpkeepNeededFd();
 
-    void release(std::unique_ptr<LinkedMemBlock> block);
+    // upkeep() grows back to minFreeBlocks whenever it finds fewer, but
+    // shrinks only when it finds more than highWatermark free blocks, and then
+    // frees at most maxShrinkFraction of the blocks above minFreeBlocks. So an
+    // oscillating load keeps its blocks instead of freeing them in one cycle
+    // and allocating them again in the next. minFreeBlocks and 1.0 by default,
+    // which shrinks back to exactly minFreeBlocks. When auto-tuning moves
+    // minFreeBlocks, the high watermark keeps the ratio it was set with.
+    void setHighWatermark(std::size_t highWatermark);
+    std::size_t getHighWatermark();
+    // Throws std::invalid_argument unless 0 < maxShrinkFraction <= 1.
+    void setMaxShrinkFraction(double maxShrinkFraction);
+    double getMaxShrinkFraction();
 
+    // Lets upkeep() move minFreeBlocks between floor and ceiling with the
+    // demand (see MinFreeBlocksTuner). The low watermark follows at half of
+    // it, and the high watermark keeps its ratio to it. Throws
+    // std::invalid_argument if floor > ceiling.
+    void enableAutoTuning(std::size_t floor, std::size_t ceiling);
+    bool isAutoTuning();
+    // The minFreeBlocks picked by the last upkeep() calls, oldest first.
+    std::vector<std::size_t> getMinFreeBlocksHistory();
+
+    std::size_t getMinFreeBlocks();
     std::size_t getFreeBlocksCount();
     std::size_t getAllocationCount();
+    // Blocks that acquire() and acquireBatch() did not find, so far.
+    std::size_t getFailedAcquireCount();
+    // Blocks carved from the slabs and not deleted yet: the free ones, the
+    // acquired ones and the retired ones.
+    std::size_t getAllocatedBlocksCount();
+    // Surplus blocks unlinked by upkeep() that still wait to be deleted.
+    std::size_t getRetiredBlocksCount();
+    // Contention on the free list (see LockFreeLinkedList).
+    std::size_t getCasRetryCount();
+    std::size_t getEliminationCount();
+    std::size_t getBlockSize();
+    std::size_t getSlabCount();
+    PageBacking getPageBacking();
+    std::size_t getAlignment();
+
+protected:
+    LockFreeLinkedMemCache(std::size_t minFreeBlocks, std::size_t blockSize,
+                           std::size_t alignment, PageBacking pageBacking, std::size_t slabSize)
+            : minFreeBlocks{minFreeBlocks},
+              lowWatermark{minFreeBlocks / 2},
+              highWatermark{minFreeBlocks},
+              highWatermarkBase{minFreeBlocks},
+              blockSize{blockSize},
+              allocator{SlabAllocator::create(this, blockPayloadOffset<LinkedMemBlock>(), blockSize, alignment,
+                                              pageBacking, slabSize)} {
+    }
+
+    SlabAllocator & getSlabAllocator();
+
+    // Called by upkeep() to make a new free block.
+    // Returns nullptr if no more blocks may be made.
+    virtual LinkedMemBlock * createBlock();
 
 private:
-    std::size_t minFreeBlocks;
+    // Only changed by upkeep(), when auto-tuning.
+    std::atomic<std::size_t> minFreeBlocks;
+    std::atomic<std::size_t> lowWatermark;
+    // As set by setHighWatermark(), and minFreeBlocks at that time. The
+    // high watermark scales with minFreeBlocks from there.
+    std::atomic<std::size_t> highWatermark;
+    std::atomic<std::size_t> highWatermarkBase;
+    std::atomic<double> maxShrinkFraction{1.0};
     std::size_t blockSize;
 
-    std::size_t growCount{0};
-    LockFreeLinkedList freeBlocks{};
+    // Declared before the free blocks so that it outlives them.
+    SlabAllocator::Pointer allocator;
+
+    // The head, the counter and the upkeep-only members are on separate
+    // cache lines, so counting does not slow down the CAS on the head.
+    alignas(cacheLineSize) LockFreeLinkedList freeBlocks{};
+
+    // Incremented before blocks are pushed and decremented after they are
+    // popped, so it is never less than the length of freeBlocks.
+    // The increments are seq_cst, see acquireFor().
+    alignas(cacheLineSize) std::atomic<std::size_t> freeBlocksCount{0};
+
+    alignas(cacheLineSize) std::atomic<std::size_t> growCount{0};
+    std::atomic<std::size_t> failedAcquireCount{0};
+
+    // Threads sleeping in acquireFor().
+    WaitQueue blockWaiters{};
 
-    void grow(LockFreeLinkedList & list, std::size_t);
-    void shrink(LockFreeLinkedList & list, std::size_t);
+    UpkeepSignal upkeepSignal{};
+
+    MinFreeBlocksTuner tuner{};
+
+    // A chain of blocks unlinked from freeBlocks at retireEpoch.
+    struct RetiredChain {
+        LinkedMemBlock * first;
+        std::size_t length;
+        std::uint64_t retireEpoch;
+    };
+
+    // Only touched by upkeep().
+    std::vector<RetiredChain> retiredChains{};
+    // Only written by upkeep(), read by getRetiredBlocksCount().
+    std::atomic<std::size_t> retiredBlocksCount{0};
+    // The free blocks upkeep() left behind and the failed acquires it saw
+    // last time.
+    std::size_t upkeptFreeBlocksCount{0};
+    std::size_t upkeptFailedAcquireCount{0};
+
+    void grow(std::size_t);
+    void shrink(std::size_t);
+    void reclaimRetiredBlocks();
+    // Called by upkeep() with the free blocks it found.
+    void tune(std::size_t count);
+    // The blocks upkeep() frees when it found count free blocks.
+    std::size_t getShrinkCount(std::size_t count, std::size_t target);
+    // Call with the count left by an acquire.
+    void signalIfLow(std::size_t count);
+    static void deleteChain(LinkedMemBlock * first);
 };
 
+inline PooledBlock<LinkedMemBlock> LockFreeLinkedMemCache::acquire() {
+    LinkedMemBlock * block{freeBlocks.popFromFront()};
+    if (block != nullptr) {
+        signalIfLow(freeBlocksCount.fetch_sub(1, std::memory_order_relaxed) - 1);
+    } else {
+        failedAcquireCount.fetch_add(1, std::memory_order_relaxed);
+        upkeepSignal.raise();
+    }
+    return PooledBlock<LinkedMemBlock>(block);
+}
+
+inline void LockFreeLinkedMemCache::release(PooledBlock<LinkedMemBlock> block) {
+    if (block == nullptr) {
+        return;
+    }
+    freeBlocksCount.fetch_add(1, std::memory_order_seq_cst);
+    freeBlocks.pushToFront(block.release());
+    blockWaiters.notifyOne();
+}
+
+inline void LockFreeLinkedMemCache::releaseToOwner(LinkedMemBlock * block) {
+    auto owner = static_cast<LockFreeLinkedMemCache *>(block->getOwner());
+    if (owner != nullptr) {
+        owner->release(PooledBlock<LinkedMemBlock>{block});
+    } else {
+        delete block;
+    }
+}
+
+inline LinkedMemBlockChain LockFreeLinkedMemCache::acquireBatch(std::size_t count) {
+    LinkedMemBlock * last;
+    std::size_t length;
+    LinkedMemBlock * first{freeBlocks.popChainFromFront(count, last, length)};
+    const std::size_t remainingCount{freeBlocksCount.fetch_sub(length, std::memory_order_relaxed) - length};
+    if (length < count) {
+        // Like a failed acquire(), even with a low watermark of 0.
+        failedAcquireCount.fetch_add(count - length, std::memory_order_relaxed);
+        upkeepSignal.raise();
+    } else {
+        signalIfLow(remainingCount);
+    }
+    return LinkedMemBlockChain{first, last, length};
+}
+
+inline void LockFreeLinkedMemCache::releaseBatch(LinkedMemBlockChain chain) {
+    LinkedMemBlock * last{chain.getLast()};
+    freeBlocksCount.fetch_add(chain.getLength(), std::memory_order_seq_cst);
+    freeBlocks.pushChainToFront(chain.release(), last);
+    blockWaiters.notifyAll();
+}
+
+inline void LockFreeLinkedMemCache::signalIfLow(std::size_t count) {
+    if (count < lowWatermark.load(std::memory_order_relaxed)) {
+        upkeepSignal.raise();
+    }
+}
+
+inline void LockFreeLinkedMemCache::setLowWatermark(std::size_t lowWatermark) {
+    this->lowWatermark.store(lowWatermark, std::memory_order_relaxed);
+}
+
+inline std::size_t LockFreeLinkedMemCache::getLowWatermark() {
+    return lowWatermark.load(std::memory_order_relaxed);
+}
+
+inline void LockFreeLinkedMemCache::setHighWatermark(std::size_t highWatermark) {
+    highWatermarkBase.store(getMinFreeBlocks(), std::memory_order_relaxed);
+    this->highWatermark.store(highWatermark, std::memory_order_relaxed);
+}
+
+inline std::size_t LockFreeLinkedMemCache::getHighWatermark() {
+    const std::size_t base{highWatermarkBase.load(std::memory_order_relaxed)};
+    const std::size_t high{highWatermark.load(std::memory_order_relaxed)};
+    const std::size_t target{getMinFreeBlocks()};
+    if (base == 0 || target == base) {
+        return high;
+    }
+    return static_cast<std::size_t>(std::llround(static_cast<double>(high) * target / base));
+}
+
+inline double LockFreeLinkedMemCache::getMaxShrinkFraction() {
+    return maxShrinkFraction.load(std::memory_order_relaxed);
+}
+
+inline bool LockFreeLinkedMemCache::waitForUpkeepNeeded(std::chrono::nanoseconds timeout) {
+    return upkeepSignal.waitFor(timeout);
+}
+
+inline bool LockFreeLinkedMemCache::isAutoTuning() {
+    return tuner.isEnabled();
+}
+
+inline std::vector<std::size_t> LockFreeLinkedMemCache::getMinFreeBlocksHistory() {
+    return tuner.getHistory();
+}
+
+inline int LockFreeLinkedMemCache::getUpkeepNeededFd() {
+    return upkeepSignal.getFd();
+}
+
+inline std::size_t LockFreeLinkedMemCache::getMinFreeBlocks() {
+    return minFreeBlocks.load(std::memory_order_relaxed);
+}
+
 inline std::size_t LockFreeLinkedMemCache::getFreeBlocksCount() {
-    return freeBlocks.calculateLength();
+    return freeBlocksCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t LockFreeLinkedMemCache::getFailedAcquireCount() {
+    return failedAcquireCount.load(std::memory_order_relaxed);
 }
 
 inline std::size_t LockFreeLinkedMemCache::getAllocationCount() {
-    return growCount;
+    return growCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t LockFreeLinkedMemCache::getRetiredBlocksCount() {
+    return retiredBlocksCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t LockFreeLinkedMemCache::getAllocatedBlocksCount() {
+    return allocator->getLiveBlocksCount();
+}
+
+inline std::size_t LockFreeLinkedMemCache::getCasRetryCount() {
+    return freeBlocks.getCasRetryCount();
+}
+
+inline std::size_t LockFreeLinkedMemCache::getEliminationCount() {
+    return freeBlocks.getEliminationCount();
+}
+
+inline std::size_t LockFreeLinkedMemCache::getBlockSize() {
+    return blockSize;
+}
+
+inline std::size_t LockFreeLinkedMemCache::getSlabCount() {
+    return allocator->getSlabCount();
+}
+
+inline PageBacking LockFreeLinkedMemCache::getPageBacking() {
+    return allocator->getPageBacking();
+}
+
+inline std::size_t LockFreeLinkedMemCache::getAlignment() {
+    return allocator->getAlignment();
+}
+
+inline SlabAllocator & LockFreeLinkedMemCache::getSlabAllocator() {
+    return *allocator;
 }
 
 #endif
@@ -2,8 +2,30 @@
 // Created by feher on 1.8.2018.
 //
 
+#include <new>
 #include "MemBlock.hpp"
 
-MemBlock::MemBlock(std::size_t blockSize)
-    : data{std::unique_ptr<uint8_t[]>(new uint8_t[blockSize])} {
+std::unique_ptr<MemBlock> MemBlock::create(std::size_t blockSize) {
+    void * memory{::operator new(blockPayloadOffset<MemBlock>() + blockSize)};
+    return std::unique_ptr<MemBlock>(::new (memory) MemBlock{nullptr});
+}
+
+std::unique_ptr<MemBlock> MemBlock::create(SlabAllocator & allocator) {
+    Slab * slab;
+    void * memory{allocator.allocate(slab)};
+    return std::unique_ptr<MemBlock>(::new (memory) MemBlock{slab});
+}
+
+MemBlock * MemBlock::createIn(void * memory) {
+    return ::new (memory) MemBlock{nullptr};
+}
+
+void MemBlock::operator delete(void * memory) {
+    // The destructor is trivial, so the header is still readable here.
+    Slab * slab{static_cast<MemBlock *>(memory)->slab};
+    if (slab != nullptr) {
+        SlabAllocator::deallocate(slab, memory);
+    } else {
+        ::operator delete(memory);
+    }
 }
@@ -5,25 +5,70 @@
 #ifndef MEM_BLOCK_HPP
 #define MEM_BLOCK_HPP
 
+#include <cassert>
 #include <memory>
 #include <cstdint>
+#include "BlockLayout.hpp"
+#include "SlabAllocator.hpp"
 
-struct MemBlock {
-    std::unique_ptr<uint8_t[]> data{nullptr};
+class MemCache;
+
+// The header and the payload of the block live in one allocation.
+// The payload follows the header at blockPayloadOffset<MemBlock>().
+// getAs<T>() checks in debug builds that the payload is aligned for T.
+struct MemBlock final {
+    // The type of the cache that owns the block. See PooledBlock.
+    using Owner = MemCache;
+
+    // The slab the block was carved from. nullptr if the block was
+    // allocated on its own.
+    Slab * slab{nullptr};
 
     MemBlock(const MemBlock &) = delete;
 
-    explicit MemBlock(std::size_t blockSize);
+    ~MemBlock() = default;
+
+    static std::unique_ptr<MemBlock> create(std::size_t blockSize);
 
-    virtual ~MemBlock() = default;
+    static std::unique_ptr<MemBlock> create(SlabAllocator & allocator);
+
+    // Makes an ownerless block in memory that belongs to someone else (see
+    // PoolMemoryResource). Such a block must not be deleted.
+    static MemBlock * createIn(void * memory);
 
     template<typename T>
     T * getAs();
+
+    // The block whose payload starts at payload, i.e. the inverse of getAs().
+    static MemBlock * fromPayload(void * payload);
+
+    // The cache whose slab the block was carved from.
+    // nullptr if the block was allocated on its own or its cache is gone.
+    void * getOwner() const;
+
+    // Blocks can only be made by create(). A plain new would not reserve
+    // room for the payload.
+    // Deleting a block gives its memory back to its slab (if any).
+    static void * operator new(std::size_t) = delete;
+    static void operator delete(void * memory);
+
+private:
+    explicit MemBlock(Slab * slab) : slab{slab} {}
 };
 
+inline MemBlock * MemBlock::fromPayload(void * payload) {
+    return reinterpret_cast<MemBlock *>(static_cast<uint8_t *>(payload) - blockPayloadOffset<MemBlock>());
+}
+
+inline void * MemBlock::getOwner() const {
+    return (slab != nullptr) ? slab->owner : nullptr;
+}
+
 template<typename T>
 T * MemBlock::getAs() {
-    return reinterpret_cast<T*>(data.get());
+    uint8_t * payload{reinterpret_cast<uint8_t *>(this) + blockPayloadOffset<MemBlock>()};
+    assert(reinterpret_cast<std::uintptr_t>(payload) % alignof(T) == 0);
+    return reinterpret_cast<T *>(payload);
 }
 
 #endif
@@ -2,48 +2,210 @@
 // Created by feher on 1.8.2018.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
 #include "MemCache.hpp"
 
 void MemCache::upkeep() {
-    std::lock_guard<std::mutex> guard{lock};
+    // Blocks are made and deleted outside the lock. The lock is only held
+    // to move pointers between freeBlocks and a private vector.
+    auto count = getFreeBlocksCount();
+    if (tuner.isEnabled()) {
+        tune(count);
+    }
+    const std::size_t target{getMinFreeBlocks()};
+    if (count < target) {
+        grow(target - count);
+    } else if (count > std::max(target, getHighWatermark())) {
+        shrink(getShrinkCount(count, target));
+    }
+    upkeptFreeBlocksCount = getFreeBlocksCount();
+}
+
+void MemCache::enableAutoTuning(std::size_t floor, std::size_t ceiling) {
+    tuner.enable(floor, ceiling, getMinFreeBlocks());
+}
 
-    auto freeBlocksCount = freeBlocks.size();
-    if (freeBlocksCount < minFreeBlocks) {
-        grow(minFreeBlocks - freeBlocksCount);
-    } else if (freeBlocksCount > minFreeBlocks) {
-        shrink(freeBlocksCount - minFreeBlocks);
+void MemCache::setMaxShrinkFraction(double maxShrinkFraction) {
+    if (!(maxShrinkFraction > 0.0 && maxShrinkFraction <= 1.0)) {
+        throw std::invalid_argument("MemCache: maxShrinkFraction must be in (0, 1]");
     }
+    this->maxShrinkFraction.store(maxShrinkFraction, std::memory_order_relaxed);
+}
+
+std::size_t MemCache::getShrinkCount(std::size_t count, std::size_t target) {
+    // At least one block, so that the surplus always drains.
+    const double surplusCount{static_cast<double>(count - target)};
+    const auto shrinkCount = static_cast<std::size_t>(std::ceil(surplusCount * getMaxShrinkFraction()));
+    return std::max<std::size_t>(shrinkCount, 1);
+}
+
+void MemCache::tune(std::size_t count) {
+    // The blocks acquired since the last upkeep(), net of the released ones.
+    const std::size_t acquiredBlocksCount{(upkeptFreeBlocksCount > count) ? upkeptFreeBlocksCount - count : 0};
+    const std::size_t failedCount{getFailedAcquireCount()};
+    const std::size_t target{tuner.update(acquiredBlocksCount, failedCount - upkeptFailedAcquireCount)};
+    upkeptFailedAcquireCount = failedCount;
+    minFreeBlocks.store(target, std::memory_order_relaxed);
+    setLowWatermark(target / 2);
 }
 
 void MemCache::grow(std::size_t blockCount) {
-    ++growCount;
+    growCount.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<std::unique_ptr<MemBlock>> newBlocks{};
+    newBlocks.reserve(blockCount);
     for (std::size_t i{0}; i < blockCount; ++i) {
-        freeBlocks.push_back(std::make_unique<MemBlock>(blockSize));
+        newBlocks.push_back(MemBlock::create(*allocator));
     }
+
+    // Every block of the cache fits into freeBlocks, so neither this
+    // nor release() reallocates it under the lock.
+    reserveFreeBlocks(allocator->getLiveBlocksCount());
+
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        std::move(newBlocks.begin(), newBlocks.end(), std::back_inserter(freeBlocks));
+        updateFreeBlocksCount();
+    }
+    blockWaiters.notifyAll();
 }
 
 void MemCache::shrink(std::size_t blockCount) {
-    for (; blockCount > 0; --blockCount) {
-        std::unique_ptr<MemBlock> freeBlock{std::move(freeBlocks.back())};
-        freeBlocks.pop_back();
+    std::vector<std::unique_ptr<MemBlock>> surplusBlocks{};
+    surplusBlocks.reserve(blockCount);
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        // The user threads may have acquired blocks since upkeep() counted them.
+        const std::size_t count{freeBlocks.size()};
+        const std::size_t target{getMinFreeBlocks()};
+        blockCount = std::min(blockCount, (count > target) ? count - target : 0);
+        auto first = freeBlocks.end() - blockCount;
+        std::move(first, freeBlocks.end(), std::back_inserter(surplusBlocks));
+        freeBlocks.erase(first, freeBlocks.end());
+        updateFreeBlocksCount();
     }
+    // The surplus blocks are deleted here, outside the lock.
 }
 
-std::unique_ptr<MemBlock> MemCache::acquire() {
+void MemCache::reserveFreeBlocks(std::size_t capacity) {
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        if (freeBlocks.capacity() >= capacity) {
+            return;
+        }
+    }
+
+    // Allocate the larger storage outside the lock. Only the pointers are moved under it.
+    std::vector<std::unique_ptr<MemBlock>> largerFreeBlocks{};
+    largerFreeBlocks.reserve(2 * capacity);
+
     std::lock_guard<std::mutex> guard{lock};
-    if (freeBlocks.empty()) {
-        return nullptr;
+    if (freeBlocks.capacity() >= capacity) {
+        return;
     }
-    std::unique_ptr<MemBlock> block{std::move(freeBlocks.back())};
-    freeBlocks.pop_back();
-    return block;
+    std::move(freeBlocks.begin(), freeBlocks.end(), std::back_inserter(largerFreeBlocks));
+    freeBlocks.swap(largerFreeBlocks);
+    // The old storage is given back after the lock is released, in the destructor of largerFreeBlocks.
 }
 
-void MemCache::release(std::unique_ptr<MemBlock> block) {
+PooledBlock<MemBlock> MemCache::acquire() {
+    PooledBlock<MemBlock> block{};
+    std::size_t count;
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        if (!freeBlocks.empty()) {
+            block.reset(freeBlocks.back().release());
+            freeBlocks.pop_back();
+            updateFreeBlocksCount();
+        }
+        count = freeBlocks.size();
+    }
     if (block == nullptr) {
+        failedAcquireCount.fetch_add(1, std::memory_order_relaxed);
+        upkeepSignal.raise();
+    } else {
+        signalIfLow(count);
+    }
+    return block;
+}
+
+PooledBlock<MemBlock> MemCache::acquireFor(std::chrono::nanoseconds timeout) {
+    PooledBlock<MemBlock> block{acquire()};
+    if (block != nullptr || timeout <= std::chrono::nanoseconds::zero()) {
+        return block;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    WaitQueue::Waiter waiter{blockWaiters};
+    for (;;) {
+        // A release() that locks before acquire() gives it the block. One
+        // that locks after it sees the waiter and changes the ticket, so
+        // wait() returns at once.
+        const std::uint32_t ticket{waiter.getTicket()};
+        block = acquire();
+        if (block != nullptr) {
+            return block;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return nullptr;
+        }
+        waiter.wait(ticket, deadline - now);
+    }
+}
+
+void MemCache::release(PooledBlock<MemBlock> block) {
+    // freeBlocks only has room for the blocks carved by this cache. Other
+    // blocks go back to their owner, or are deleted, when block is destroyed.
+    if (block == nullptr || block->getOwner() != this) {
         return;
     }
-    std::lock_guard<std::mutex> guard{lock};
-    freeBlocks.push_back(std::move(block));
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        freeBlocks.emplace_back(block.release());
+        updateFreeBlocksCount();
+    }
+    blockWaiters.notifyOne();
 }
 
+
+std::size_t MemCache::acquireBatch(std::vector<PooledBlock<MemBlock>> & blocks, std::size_t count) {
+    const std::size_t requestedCount{count};
+    std::size_t remainingCount;
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        count = std::min(count, freeBlocks.size());
+        for (std::size_t i{0}; i < count; ++i) {
+            blocks.emplace_back(freeBlocks.back().release());
+            freeBlocks.pop_back();
+        }
+        updateFreeBlocksCount();
+        remainingCount = freeBlocks.size();
+    }
+    if (count < requestedCount) {
+        // Like a failed acquire(), even with a low watermark of 0.
+        failedAcquireCount.fetch_add(requestedCount - count, std::memory_order_relaxed);
+        upkeepSignal.raise();
+    } else {
+        signalIfLow(remainingCount);
+    }
+    return count;
+}
+
+void MemCache::releaseBatch(std::vector<PooledBlock<MemBlock>> & blocks) {
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        for (auto & block : blocks) {
+            if (block != nullptr && block->getOwner() == this) {
+                freeBlocks.emplace_back(block.release());
+            }
+        }
+        updateFreeBlocksCount();
+    }
+    // The blocks of other caches go back to their owner here, outside the lock.
+    blocks.clear();
+    blockWaiters.notifyAll();
+}
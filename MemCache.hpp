@@ -11,17 +11,37 @@
 #ifndef MEM_CACHE_HPP
 #define MEM_CACHE_HPP
 
+#include <atomic>
+#include <cmath>
+#include <chrono>
 #include <cstddef>
 #include <mutex>
 #include <vector>
 #include <memory>
 #include "MemBlock.hpp"
+#include "MinFreeBlocksTuner.hpp"
+#include "PooledBlock.hpp"
+#include "UpkeepSignal.hpp"
+#include "WaitQueue.hpp"
 
 class MemCache {
 public:
-    MemCache(std::size_t minFreeBlocks, std::size_t blockSize)
+    using Block = MemBlock;
+
+    // alignment: Alignment of every block's payload. A power of two.
+    //   E.g. 64 keeps blocks off each other's cache lines, 4096 gives
+    //   page aligned blocks.
+    // pageBacking: The preferred backing of the block memory.
+    //   See getPageBacking() for the backing that was actually got.
+    MemCache(std::size_t minFreeBlocks, std::size_t blockSize,
+             std::size_t alignment = defaultBlockAlignment,
+             PageBacking pageBacking = PageBacking::SmallPages)
             : minFreeBlocks{minFreeBlocks},
-              blockSize{blockSize} {
+              lowWatermark{minFreeBlocks / 2},
+              highWatermark{minFreeBlocks},
+              highWatermarkBase{minFreeBlocks},
+              blockSize{blockSize},
+              allocator{SlabAllocator::create(this, blockPayloadOffset<MemBlock>(), blockSize, alignment, pageBacking)} {
     }
 
     MemCache(const MemCache &) = delete;
@@ -30,32 +50,224 @@ public:
 
     void upkeep();
 
-    std::unique_ptr<MemBlock> acquire();
+    // The acquired block goes back to this cache when it is destroyed.
+    PooledBlock<MemBlock> acquire();
+
+    // Like acquire(), but if there is no free block it sleeps until
+    // release() or upkeep() gives one back, or until timeout.
+    // Returns nullptr on timeout.
+    PooledBlock<MemBlock> acquireFor(std::chrono::nanoseconds timeout);
+
+    void release(PooledBlock<MemBlock> block);
+
+    // Appends at most count blocks to blocks with one lock acquisition.
+    // Returns the number of acquired blocks. Reserve room in blocks
+    // beforehand to avoid allocating memory.
+    std::size_t acquireBatch(std::vector<PooledBlock<MemBlock>> & blocks, std::size_t count);
+
+    // Releases every block of blocks with one lock acquisition.
+    // blocks is empty afterwards.
+    void releaseBatch(std::vector<PooledBlock<MemBlock>> & blocks);
+
+    // Gives the block back to the cache that carved it. Used by PooledBlock.
+    static void releaseToOwner(MemBlock * block);
+
+    // acquire() and acquireBatch() signal that upkeep() is needed when they
+    // leave fewer than lowWatermark free blocks or find too few.
+    // minFreeBlocks / 2 by default.
+    void setLowWatermark(std::size_t lowWatermark);
+    std::size_t getLowWatermark();
+
+    // Sleeps until upkeep() is needed (see setLowWatermark()) or until timeout.
+    // Returns false on timeout. Meant for the thread that calls upkeep().
+    bool waitForUpkeepNeeded(std::chrono::nanoseconds timeout);
 
-    void release(std::unique_ptr<MemBlock> block);
+    // An eventfd for epoll loops, readable when upkeep() is needed. Then call
+    // waitForUpkeepNeeded(0) to clear it, and upkeep(). It may be readable spuriously.
+    int getUpkeepNeededFd();
 
+    // upkeep() grows back to minFreeBlocks whenever it finds fewer, but
+    // shrinks only when it finds more than highWatermark free blocks, and then
+    // frees at most maxShrinkFraction of the blocks above minFreeBlocks. So an
+    // oscillating load keeps its blocks instead of freeing them in one cycle
+    // and allocating them again in the next. minFreeBlocks and 1.0 by default,
+    // which shrinks back to exactly minFreeBlocks. When auto-tuning moves
+    // minFreeBlocks, the high watermark keeps the ratio it was set with.
+    void setHighWatermark(std::size_t highWatermark);
+    std::size_t getHighWatermark();
+    // Throws std::invalid_argument unless 0 < maxShrinkFraction <= 1.
+    void setMaxShrinkFraction(double maxShrinkFraction);
+    double getMaxShrinkFraction();
+
+    // Lets upkeep() move minFreeBlocks between floor and ceiling with the
+    // demand (see MinFreeBlocksTuner). The low watermark follows at half of
+    // it, and the high watermark keeps its ratio to it. Throws
+    // std::invalid_argument if floor > ceiling.
+    void enableAutoTuning(std::size_t floor, std::size_t ceiling);
+    bool isAutoTuning();
+    // The minFreeBlocks picked by the last upkeep() calls, oldest first.
+    std::vector<std::size_t> getMinFreeBlocksHistory();
+
+    std::size_t getMinFreeBlocks();
     std::size_t getFreeBlocksCount();
     std::size_t getAllocationCount();
+    // Blocks that acquire() and acquireBatch() did not find, so far.
+    std::size_t getFailedAcquireCount();
+    // Blocks carved from the slabs and not deleted yet: the free ones, the
+    // acquired ones.
+    std::size_t getAllocatedBlocksCount();
+    std::size_t getBlockSize();
+    std::size_t getSlabCount();
+    PageBacking getPageBacking();
+    std::size_t getAlignment();
 
 private:
-    std::size_t minFreeBlocks;
+    // Only changed by upkeep(), when auto-tuning.
+    std::atomic<std::size_t> minFreeBlocks;
+    std::atomic<std::size_t> lowWatermark;
+    // As set by setHighWatermark(), and minFreeBlocks at that time. The
+    // high watermark scales with minFreeBlocks from there.
+    std::atomic<std::size_t> highWatermark;
+    std::atomic<std::size_t> highWatermarkBase;
+    std::atomic<double> maxShrinkFraction{1.0};
     std::size_t blockSize;
 
-    std::size_t growCount{0};
+    // Declared before the free blocks so that it outlives them.
+    SlabAllocator::Pointer allocator;
     std::vector<std::unique_ptr<MemBlock>> freeBlocks{};
 
     std::mutex lock{};
 
+    // Written under the lock, read without it. On their own cache line, so
+    // monitoring threads do not bounce the line of the mutex.
+    alignas(cacheLineSize) std::atomic<std::size_t> freeBlocksCount{0};
+    std::atomic<std::size_t> growCount{0};
+    std::atomic<std::size_t> failedAcquireCount{0};
+
+    // Threads sleeping in acquireFor(). Notified after the lock is released.
+    WaitQueue blockWaiters{};
+
+    UpkeepSignal upkeepSignal{};
+
+    MinFreeBlocksTuner tuner{};
+    // Only touched by upkeep(). The free blocks it left behind and the
+    // failed acquires it saw last time.
+    std::size_t upkeptFreeBlocksCount{0};
+    std::size_t upkeptFailedAcquireCount{0};
+
+    // Call with the lock held after freeBlocks changed.
+    void updateFreeBlocksCount();
+
+    // Call after the lock is released with the count left by an acquire.
+    void signalIfLow(std::size_t count);
+
     void grow(std::size_t);
     void shrink(std::size_t);
+    // Called by upkeep() with the free blocks it found.
+    void tune(std::size_t count);
+    // The blocks upkeep() frees when it found count free blocks.
+    std::size_t getShrinkCount(std::size_t count, std::size_t target);
+
+    // Makes room for capacity block pointers in freeBlocks.
+    void reserveFreeBlocks(std::size_t capacity);
 };
 
+inline void MemCache::releaseToOwner(MemBlock * block) {
+    auto owner = static_cast<MemCache *>(block->getOwner());
+    if (owner != nullptr) {
+        owner->release(PooledBlock<MemBlock>{block});
+    } else {
+        delete block;
+    }
+}
+
+inline void MemCache::updateFreeBlocksCount() {
+    freeBlocksCount.store(freeBlocks.size(), std::memory_order_relaxed);
+}
+
+inline void MemCache::signalIfLow(std::size_t count) {
+    if (count < lowWatermark.load(std::memory_order_relaxed)) {
+        upkeepSignal.raise();
+    }
+}
+
+inline void MemCache::setLowWatermark(std::size_t lowWatermark) {
+    this->lowWatermark.store(lowWatermark, std::memory_order_relaxed);
+}
+
+inline std::size_t MemCache::getLowWatermark() {
+    return lowWatermark.load(std::memory_order_relaxed);
+}
+
+inline void MemCache::setHighWatermark(std::size_t highWatermark) {
+    highWatermarkBase.store(getMinFreeBlocks(), std::memory_order_relaxed);
+    this->highWatermark.store(highWatermark, std::memory_order_relaxed);
+}
+
+inline std::size_t MemCache::getHighWatermark() {
+    const std::size_t base{highWatermarkBase.load(std::memory_order_relaxed)};
+    const std::size_t high{highWatermark.load(std::memory_order_relaxed)};
+    const std::size_t target{getMinFreeBlocks()};
+    if (base == 0 || target == base) {
+        return high;
+    }
+    return static_cast<std::size_t>(std::llround(static_cast<double>(high) * target / base));
+}
+
+inline double MemCache::getMaxShrinkFraction() {
+    return maxShrinkFraction.load(std::memory_order_relaxed);
+}
+
+inline bool MemCache::waitForUpkeepNeeded(std::chrono::nanoseconds timeout) {
+    return upkeepSignal.waitFor(timeout);
+}
+
+inline bool MemCache::isAutoTuning() {
+    return tuner.isEnabled();
+}
+
+inline std::vector<std::size_t> MemCache::getMinFreeBlocksHistory() {
+    return tuner.getHistory();
+}
+
+inline int MemCache::getUpkeepNeededFd() {
+    return upkeepSignal.getFd();
+}
+
+inline std::size_t MemCache::getMinFreeBlocks() {
+    return minFreeBlocks.load(std::memory_order_relaxed);
+}
+
 inline std::size_t MemCache::getFreeBlocksCount() {
-    return freeBlocks.size();
+    return freeBlocksCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t MemCache::getFailedAcquireCount() {
+    return failedAcquireCount.load(std::memory_order_relaxed);
 }
 
 inline std::size_t MemCache::getAllocationCount() {
-    return growCount;
+    return growCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t MemCache::getAllocatedBlocksCount() {
+    return allocator->getLiveBlocksCount();
+}
+
+inline std::size_t MemCache::getBlockSize() {
+    return blockSize;
+}
+
+inline std::size_t MemCache::getSlabCount() {
+    return allocator->getSlabCount();
+}
+
+inline PageBacking MemCache::getPageBacking() {
+    return allocator->getPageBacking();
+}
+
+inline std::size_t MemCache::getAlignment() {
+    return allocator->getAlignment();
 }
 
 #endif
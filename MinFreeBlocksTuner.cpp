@@ -0,0 +1,46 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "MinFreeBlocksTuner.hpp"
+
+constexpr double MinFreeBlocksTuner::smoothing;
+constexpr double MinFreeBlocksTuner::headroom;
+constexpr std::size_t MinFreeBlocksTuner::historyLength;
+
+void MinFreeBlocksTuner::enable(std::size_t floor, std::size_t ceiling, std::size_t initialTarget) {
+    if (floor > ceiling) {
+        throw std::invalid_argument("MinFreeBlocksTuner: The floor is above the ceiling");
+    }
+    std::lock_guard<std::mutex> guard{lock};
+    isOn = true;
+    this->floor = floor;
+    this->ceiling = ceiling;
+    // As if the demand had always matched the initial target.
+    averageDemand = static_cast<double>(std::min(std::max(initialTarget, floor), ceiling)) / headroom;
+    history.clear();
+}
+
+bool MinFreeBlocksTuner::isEnabled() {
+    std::lock_guard<std::mutex> guard{lock};
+    return isOn;
+}
+
+std::size_t MinFreeBlocksTuner::update(std::size_t acquiredBlocksCount, std::size_t failedAcquireCount) {
+    std::lock_guard<std::mutex> guard{lock};
+    const double demand{static_cast<double>(acquiredBlocksCount + failedAcquireCount)};
+    averageDemand = smoothing * demand + (1.0 - smoothing) * averageDemand;
+
+    const double target{std::ceil(averageDemand * headroom)};
+    const std::size_t clampedTarget{
+            (target >= static_cast<double>(ceiling)) ? ceiling : std::max(floor, static_cast<std::size_t>(target))};
+    history.push_back(clampedTarget);
+    if (history.size() > historyLength) {
+        history.pop_front();
+    }
+    return clampedTarget;
+}
+
+std::vector<std::size_t> MinFreeBlocksTuner::getHistory() {
+    std::lock_guard<std::mutex> guard{lock};
+    return std::vector<std::size_t>{history.begin(), history.end()};
+}
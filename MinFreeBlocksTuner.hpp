@@ -0,0 +1,59 @@
+//
+// Picks minFreeBlocks of a cache from its recent demand.
+//
+// upkeep() reports how many blocks were acquired since the previous
+// upkeep() (net of the released ones) and how many acquires failed. A failed
+// acquire is demand that found no block, so both count as demand. The
+// demand is smoothed with an exponentially weighted moving average, and the
+// target is that average plus headroom, clamped to [floor, ceiling]. So a
+// cache under bursts grows its target before acquires fail again, and an
+// idle one gives its blocks back over a few cycles.
+//
+// Disabled until enable() is called. All functions may be called from any
+// thread.
+//
+
+#ifndef MIN_FREE_BLOCKS_TUNER_HPP
+#define MIN_FREE_BLOCKS_TUNER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+class MinFreeBlocksTuner {
+public:
+    // Weight of the newest cycle in the average.
+    static constexpr double smoothing{0.25};
+    // The target is this much above the average demand.
+    static constexpr double headroom{1.5};
+    // Number of targets kept by getHistory().
+    static constexpr std::size_t historyLength{64};
+
+    MinFreeBlocksTuner() = default;
+
+    MinFreeBlocksTuner(const MinFreeBlocksTuner &) = delete;
+
+    virtual ~MinFreeBlocksTuner() = default;
+
+    // Starts from initialTarget. Throws std::invalid_argument if floor > ceiling.
+    void enable(std::size_t floor, std::size_t ceiling, std::size_t initialTarget);
+
+    bool isEnabled();
+
+    // Returns the new target.
+    std::size_t update(std::size_t acquiredBlocksCount, std::size_t failedAcquireCount);
+
+    // The targets picked by update(), oldest first.
+    std::vector<std::size_t> getHistory();
+
+private:
+    std::mutex lock{};
+    bool isOn{false};
+    std::size_t floor{0};
+    std::size_t ceiling{0};
+    double averageDemand{0.0};
+    std::deque<std::size_t> history{};
+};
+
+#endif
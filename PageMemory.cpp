@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "BlockLayout.hpp"
+#include "PageMemory.hpp"
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+
+namespace {
+
+uint8_t * mapAnonymous(std::size_t size, int extraFlags) {
+    void * memory{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0)};
+    return (memory == MAP_FAILED) ? nullptr : static_cast<uint8_t *>(memory);
+}
+
+bool mapHugeTlbPages(std::size_t size, PageMapping & mapping) {
+#ifdef MAP_HUGETLB
+    // Fails with ENOMEM if there are not enough reserved huge pages.
+    uint8_t * memory{mapAnonymous(size, MAP_HUGETLB | MAP_HUGE_2MB)};
+    if (memory == nullptr) {
+        return false;
+    }
+    mapping = PageMapping{memory, size, PageBacking::HugeTlbPages};
+    return true;
+#else
+    (void) size;
+    (void) mapping;
+    return false;
+#endif
+}
+
+bool areTransparentHugePagesEnabled() {
+    // E.g. "always [madvise] never"
+    std::ifstream file{"/sys/kernel/mm/transparent_hugepage/enabled"};
+    std::string modes{};
+    std::getline(file, modes);
+    return !modes.empty() && (modes.find("[never]") == std::string::npos);
+}
+
+// The AnonHugePages of the mapping that contains address, in kB.
+std::size_t readAnonHugePagesKb(const uint8_t * address) {
+    // Every mapping starts with a line like "7f0c00000000-7f0c00400000 rw-p ..."
+    // and is followed by its fields, e.g. "AnonHugePages:      2048 kB".
+    std::ifstream file{"/proc/self/smaps"};
+    const auto target = reinterpret_cast<std::uintptr_t>(address);
+    bool isTargetMapping{false};
+    std::string line{};
+    while (std::getline(file, line)) {
+        unsigned long long start{0};
+        unsigned long long end{0};
+        if (std::sscanf(line.c_str(), "%llx-%llx ", &start, &end) == 2) {
+            isTargetMapping = (start <= target && target < end);
+        } else if (isTargetMapping && line.compare(0, 14, "AnonHugePages:") == 0) {
+            return std::stoul(line.substr(14));
+        }
+    }
+    return 0;
+}
+
+// Faults in the huge page at address and checks whether it became one. The
+// mapping may have been merged with a neighbor, so compare before and after.
+bool isTransparentHugePage(uint8_t * address) {
+    const std::size_t anonHugePagesKb{readAnonHugePagesKb(address)};
+    *reinterpret_cast<volatile uint8_t *>(address) = 0;
+    return readAnonHugePagesKb(address) >= anonHugePagesKb + hugePageSize / 1024;
+}
+
+bool mapTransparentHugePages(std::size_t size, PageMapping & mapping) {
+#ifdef MADV_HUGEPAGE
+    static const bool isEnabled{areTransparentHugePagesEnabled()};
+    if (!isEnabled) {
+        return false;
+    }
+
+    // Huge pages are only used for 2 MiB aligned ranges, so map one more
+    // huge page and cut off the unaligned head and tail.
+    uint8_t * memory{mapAnonymous(size + hugePageSize, 0)};
+    if (memory == nullptr) {
+        return false;
+    }
+    auto address = reinterpret_cast<std::uintptr_t>(memory);
+    auto alignedMemory = reinterpret_cast<uint8_t *>(alignUp(address, hugePageSize));
+    std::size_t headSize{static_cast<std::size_t>(alignedMemory - memory)};
+    if (headSize > 0) {
+        munmap(memory, headSize);
+    }
+    munmap(alignedMemory + size, hugePageSize - headSize);
+
+    if (madvise(alignedMemory, size, MADV_HUGEPAGE) != 0) {
+        mapping = PageMapping{alignedMemory, size, PageBacking::SmallPages};
+        return true;
+    }
+
+    // Reading smaps walks every mapping of the process under its mmap lock,
+    // so only the first mapping is checked and the verdict is kept for the
+    // rest of the process.
+    static const bool isConfirmed{isTransparentHugePage(alignedMemory)};
+    mapping = PageMapping{alignedMemory, size,
+                          isConfirmed ? PageBacking::TransparentHugePages : PageBacking::AdvisedHugePages};
+    return true;
+#else
+    (void) size;
+    (void) mapping;
+    return false;
+#endif
+}
+
+}
+
+const char * toString(PageBacking backing) {
+    switch (backing) {
+        case PageBacking::SmallPages:
+            return "small pages";
+        case PageBacking::AdvisedHugePages:
+            return "advised huge pages";
+        case PageBacking::TransparentHugePages:
+            return "transparent huge pages";
+        case PageBacking::HugeTlbPages:
+            return "hugetlbfs pages";
+    }
+    return "unknown";
+}
+
+PageMapping mapPages(std::size_t size, PageBacking preferred) {
+    PageMapping mapping{};
+    if (preferred != PageBacking::SmallPages) {
+        size = alignUp(size, hugePageSize);
+    }
+    if (preferred == PageBacking::HugeTlbPages && mapHugeTlbPages(size, mapping)) {
+        return mapping;
+    }
+    if (preferred != PageBacking::SmallPages && mapTransparentHugePages(size, mapping)) {
+        return mapping;
+    }
+
+    uint8_t * memory{mapAnonymous(size, 0)};
+    if (memory == nullptr) {
+        throw std::bad_alloc{};
+    }
+    return PageMapping{memory, size, PageBacking::SmallPages};
+}
+
+void unmapPages(const PageMapping & mapping) {
+    munmap(mapping.memory, mapping.size);
+}
@@ -0,0 +1,47 @@
+//
+// Maps the memory that the slabs are carved from.
+// Small pages come from a plain anonymous mapping. Huge pages come from
+// hugetlbfs (MAP_HUGETLB) if pages are reserved there, otherwise from
+// transparent huge pages (madvise(MADV_HUGEPAGE)).
+//
+// The kernel may refuse huge pages at any time, so every mapping
+// reports the backing it actually got. madvise() succeeding does not mean
+// that the kernel has a huge page at hand (e.g. with defrag "defer" or
+// "never"), so transparent huge pages are only reported after the first
+// page of the first such mapping of the process faulted in as one
+// (AnonHugePages in /proc/self/smaps). Otherwise the mappings are only
+// advised.
+//
+
+#ifndef PAGE_MEMORY_HPP
+#define PAGE_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Ordered from the weakest to the strongest backing.
+enum class PageBacking {
+    SmallPages,
+    // madvise(MADV_HUGEPAGE) succeeded, but no huge page could be confirmed.
+    AdvisedHugePages,
+    TransparentHugePages,
+    HugeTlbPages
+};
+
+const char * toString(PageBacking backing);
+
+struct PageMapping {
+    uint8_t * memory{nullptr};
+    std::size_t size{0};
+    PageBacking backing{PageBacking::SmallPages};
+};
+
+const std::size_t hugePageSize{2 * 1024 * 1024};
+
+// Maps at least size bytes. Falls back from the preferred backing to
+// weaker ones. Throws std::bad_alloc if even small pages can not be mapped.
+PageMapping mapPages(std::size_t size, PageBacking preferred);
+
+void unmapPages(const PageMapping & mapping);
+
+#endif
@@ -0,0 +1,38 @@
+#include "PerCpuLinkedMemCache.hpp"
+
+PerCpuLinkedMemCache::PerCpuLinkedMemCache(std::size_t minFreeBlocks, std::size_t blockSize, std::size_t cpuCount,
+                                           std::size_t alignment, PageBacking pageBacking)
+        : blockSize{blockSize} {
+    if (cpuCount == 0) {
+        cpuCount = getCpuCount();
+    }
+
+    // Every list gets its share of minFreeBlocks. The first ones get the remainder.
+    for (std::size_t i{0}; i < cpuCount; ++i) {
+        const std::size_t listMinFreeBlocks{minFreeBlocks / cpuCount + ((i < minFreeBlocks % cpuCount) ? 1 : 0)};
+        cpuLists.push_back(std::make_unique<LockFreeLinkedMemCache>(listMinFreeBlocks, blockSize, alignment,
+                                                                    pageBacking));
+    }
+}
+
+void PerCpuLinkedMemCache::upkeep() {
+    for (auto & cpuList : cpuLists) {
+        cpuList->upkeep();
+    }
+}
+
+std::size_t PerCpuLinkedMemCache::getFreeBlocksCount() {
+    std::size_t count{0};
+    for (auto & cpuList : cpuLists) {
+        count += cpuList->getFreeBlocksCount();
+    }
+    return count;
+}
+
+std::size_t PerCpuLinkedMemCache::getAllocationCount() {
+    std::size_t count{0};
+    for (auto & cpuList : cpuLists) {
+        count += cpuList->getAllocationCount();
+    }
+    return count;
+}
@@ -0,0 +1,134 @@
+//
+// This is a front-end over several LockFreeLinkedMemCaches, one per CPU.
+//
+// acquire() and release() use the free list of the CPU the calling thread
+// runs on (see CurrentCpu). Threads running on different CPUs never touch
+// the same list head, so the CAS on it is effectively uncontended, no
+// matter how many threads there are. Two threads of the same CPU only meet
+// on the same head if one is preempted in the middle of a CAS, and the
+// tagged head of LockFreeLinkedList keeps that correct.
+//
+// Unlike ThreadLocalMemCache the free blocks are kept per CPU, not per
+// thread, so with many more threads than CPUs the idle memory still only
+// grows with the number of CPUs.
+//
+// If the list of the current CPU is empty, acquire() steals from the lists
+// of the next CPUs. upkeep() upkeeps every list to its share of
+// minFreeBlocks. Like LockFreeLinkedMemCache::upkeep() it is meant to be
+// run periodically from one thread.
+//
+
+#ifndef PER_CPU_LINKED_MEM_CACHE_HPP
+#define PER_CPU_LINKED_MEM_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "CurrentCpu.hpp"
+#include "LockFreeLinkedMemCache.hpp"
+
+class PerCpuLinkedMemCache {
+public:
+    using Block = LinkedMemBlock;
+
+    // cpuCount: Number of free lists. 0 means one per CPU of the system.
+    //   With fewer lists than CPUs some CPUs share a list.
+    PerCpuLinkedMemCache(std::size_t minFreeBlocks, std::size_t blockSize, std::size_t cpuCount = 0,
+                         std::size_t alignment = defaultBlockAlignment,
+                         PageBacking pageBacking = PageBacking::SmallPages);
+
+    PerCpuLinkedMemCache(const PerCpuLinkedMemCache &) = delete;
+
+    virtual ~PerCpuLinkedMemCache() = default;
+
+    void upkeep();
+
+    // The acquired block goes back to the list it was carved for when it
+    // is destroyed.
+    PooledBlock<LinkedMemBlock> acquire();
+
+    // Blocks of other caches or without a cache are given back to their
+    // owner or deleted.
+    void release(PooledBlock<LinkedMemBlock> block);
+
+    std::size_t getCpuListCount();
+    std::size_t getFreeBlocksCount(std::size_t cpuListIndex);
+    // The list that acquire() and release() of the calling thread use now.
+    std::size_t getCurrentCpuListIndex();
+
+    std::size_t getFreeBlocksCount();
+    std::size_t getAllocationCount();
+    // Acquires served by another CPU's list because the current one was empty.
+    std::size_t getStealCount();
+    std::size_t getBlockSize();
+
+private:
+    std::size_t blockSize;
+
+    std::vector<std::unique_ptr<LockFreeLinkedMemCache>> cpuLists{};
+
+    alignas(cacheLineSize) std::atomic<std::size_t> stealCount{0};
+
+    bool isCpuList(const LockFreeLinkedMemCache * memCache);
+};
+
+inline bool PerCpuLinkedMemCache::isCpuList(const LockFreeLinkedMemCache * memCache) {
+    for (const std::unique_ptr<LockFreeLinkedMemCache> & cpuList : cpuLists) {
+        if (cpuList.get() == memCache) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline std::size_t PerCpuLinkedMemCache::getCurrentCpuListIndex() {
+    return getCurrentCpu() % cpuLists.size();
+}
+
+inline PooledBlock<LinkedMemBlock> PerCpuLinkedMemCache::acquire() {
+    const std::size_t cpuListIndex{getCurrentCpuListIndex()};
+    PooledBlock<LinkedMemBlock> block{cpuLists[cpuListIndex]->acquire()};
+    if (block != nullptr) {
+        return block;
+    }
+    for (std::size_t i{1}; i < cpuLists.size(); ++i) {
+        block = cpuLists[(cpuListIndex + i) % cpuLists.size()]->acquire();
+        if (block != nullptr) {
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+    return nullptr;
+}
+
+inline void PerCpuLinkedMemCache::release(PooledBlock<LinkedMemBlock> block) {
+    if (block == nullptr) {
+        return;
+    }
+    auto owner = static_cast<LockFreeLinkedMemCache *>(block->getOwner());
+    if (owner == nullptr || !isCpuList(owner)) {
+        return;
+    }
+    // A linked list has room for any number of blocks, so the block may
+    // move to the list of the current CPU.
+    cpuLists[getCurrentCpuListIndex()]->release(std::move(block));
+}
+
+inline std::size_t PerCpuLinkedMemCache::getCpuListCount() {
+    return cpuLists.size();
+}
+
+inline std::size_t PerCpuLinkedMemCache::getFreeBlocksCount(std::size_t cpuListIndex) {
+    return cpuLists[cpuListIndex]->getFreeBlocksCount();
+}
+
+inline std::size_t PerCpuLinkedMemCache::getStealCount() {
+    return stealCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t PerCpuLinkedMemCache::getBlockSize() {
+    return blockSize;
+}
+
+#endif
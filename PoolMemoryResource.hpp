@@ -0,0 +1,128 @@
+//
+// A std::pmr::memory_resource that serves allocations from the blocks of
+// a cache (MemCache or LockFreeLinkedMemCache). E.g. the nodes of a
+// std::pmr::list or std::pmr::map come from preallocated blocks and the
+// container stays off malloc().
+//
+// Allocations that do not fit into a block (too large or too strictly
+// aligned) are forwarded to the upstream resource.
+// If the cache has no free block, the allocation is served by the upstream
+// resource too, with an ownerless block header in front of it. Deallocation
+// tells the two apart by the owner of the header and gives such memory back
+// to upstream. getFallbackCount() tells how often that happened, so
+// minFreeBlocks can be tuned.
+//
+// The resource is as thread safe as the cache's acquire() and release().
+//
+
+#ifndef POOL_MEMORY_RESOURCE_HPP
+#define POOL_MEMORY_RESOURCE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include "BlockLayout.hpp"
+#include "PooledBlock.hpp"
+
+template<typename MemCacheT>
+class PoolMemoryResource : public std::pmr::memory_resource {
+public:
+    using Block = typename MemCacheT::Block;
+
+    explicit PoolMemoryResource(MemCacheT & memCache,
+                                std::pmr::memory_resource * upstream = std::pmr::get_default_resource())
+            : memCache{memCache},
+              upstream{upstream},
+              blockSize{memCache.getBlockSize()},
+              alignment{memCache.getAlignment()} {
+    }
+
+    PoolMemoryResource(const PoolMemoryResource &) = delete;
+
+    std::pmr::memory_resource * getUpstream() const;
+
+    std::size_t getFallbackCount() const;
+
+protected:
+    void * do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+    void do_deallocate(void * memory, std::size_t bytes, std::size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override;
+
+private:
+    MemCacheT & memCache;
+    std::pmr::memory_resource * upstream;
+    std::size_t blockSize;
+    std::size_t alignment;
+
+    std::atomic<std::size_t> fallbackCount{0};
+
+    bool fitsIntoBlock(std::size_t bytes, std::size_t alignment) const;
+
+    // Where the payload starts in an upstream allocation with a block header.
+    static std::size_t fallbackPayloadOffset(std::size_t alignment);
+};
+
+template<typename MemCacheT>
+inline std::pmr::memory_resource * PoolMemoryResource<MemCacheT>::getUpstream() const {
+    return upstream;
+}
+
+template<typename MemCacheT>
+inline std::size_t PoolMemoryResource<MemCacheT>::getFallbackCount() const {
+    return fallbackCount.load(std::memory_order_relaxed);
+}
+
+template<typename MemCacheT>
+inline bool PoolMemoryResource<MemCacheT>::fitsIntoBlock(std::size_t bytes, std::size_t alignment) const {
+    return (bytes <= blockSize) && (alignment <= this->alignment);
+}
+
+template<typename MemCacheT>
+inline std::size_t PoolMemoryResource<MemCacheT>::fallbackPayloadOffset(std::size_t alignment) {
+    return alignUp(blockPayloadOffset<Block>(), alignment);
+}
+
+template<typename MemCacheT>
+void * PoolMemoryResource<MemCacheT>::do_allocate(std::size_t bytes, std::size_t alignment) {
+    if (!fitsIntoBlock(bytes, alignment)) {
+        return upstream->allocate(bytes, alignment);
+    }
+    PooledBlock<Block> block{memCache.acquire()};
+    if (block != nullptr) {
+        return block.release()->template getAs<uint8_t>();
+    }
+    fallbackCount.fetch_add(1, std::memory_order_relaxed);
+    alignment = std::max(alignment, defaultBlockAlignment);
+    const std::size_t offset{fallbackPayloadOffset(alignment)};
+    auto memory = static_cast<uint8_t *>(upstream->allocate(offset + bytes, alignment));
+    Block::createIn(memory + offset - blockPayloadOffset<Block>());
+    return memory + offset;
+}
+
+template<typename MemCacheT>
+void PoolMemoryResource<MemCacheT>::do_deallocate(void * memory, std::size_t bytes, std::size_t alignment) {
+    if (!fitsIntoBlock(bytes, alignment)) {
+        upstream->deallocate(memory, bytes, alignment);
+        return;
+    }
+    Block * block{Block::fromPayload(memory)};
+    if (block->getOwner() == nullptr) {
+        alignment = std::max(alignment, defaultBlockAlignment);
+        const std::size_t offset{fallbackPayloadOffset(alignment)};
+        upstream->deallocate(static_cast<uint8_t *>(memory) - offset, offset + bytes, alignment);
+        return;
+    }
+    // Goes back to its cache.
+    PooledBlock<Block> pooledBlock{block};
+}
+
+template<typename MemCacheT>
+bool PoolMemoryResource<MemCacheT>::do_is_equal(const std::pmr::memory_resource & other) const noexcept {
+    return this == &other;
+}
+
+#endif
@@ -0,0 +1,41 @@
+//
+// A std::unique_ptr for memory blocks that gives the block back to the
+// cache that owns it when it is destroyed. So a block that is dropped,
+// or lost on an exception path, goes back to the pool instead of the heap.
+//
+// The deleter has no state. The block knows its cache (see getOwner()),
+// and the type of the cache is Block::Owner. So a PooledBlock is one
+// pointer wide and releasing it is a direct call.
+// Blocks without an owner (e.g. made by Block::create(blockSize)) are deleted.
+//
+
+#ifndef POOLED_BLOCK_HPP
+#define POOLED_BLOCK_HPP
+
+#include <memory>
+#include <type_traits>
+
+template<typename Block>
+struct ReturnToOwner {
+    ReturnToOwner() = default;
+
+    // Adopts blocks held by a plain std::unique_ptr.
+    template<typename T>
+    ReturnToOwner(const std::default_delete<T> &) {}
+
+    // Converts from derived block types (e.g. FixedMemBlock).
+    template<typename DerivedBlock, typename = typename std::enable_if<std::is_base_of<Block, DerivedBlock>::value>::type>
+    ReturnToOwner(const ReturnToOwner<DerivedBlock> &) {}
+
+    void operator()(Block * block) const;
+};
+
+template<typename Block>
+using PooledBlock = std::unique_ptr<Block, ReturnToOwner<Block>>;
+
+template<typename Block>
+void ReturnToOwner<Block>::operator()(Block * block) const {
+    Block::Owner::releaseToOwner(block);
+}
+
+#endif
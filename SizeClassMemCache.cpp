@@ -0,0 +1,55 @@
+#include <limits>
+#include <stdexcept>
+#include "SizeClassMemCache.hpp"
+
+SizeClassMemCache::SizeClassMemCache(std::size_t minFreeBlocks, std::size_t minBlockSize,
+                                     std::size_t maxBlockSize, std::size_t alignment,
+                                     PageBacking pageBacking)
+        : minBlockSize{minBlockSize},
+          maxBlockSize{maxBlockSize} {
+    if (!isPowerOfTwo(minBlockSize)) {
+        throw std::invalid_argument{"Smallest block size must be a power of two"};
+    }
+
+    for (std::size_t blockSize{minBlockSize}; ; blockSize *= 2) {
+        if (classes.size() > std::numeric_limits<uint8_t>::max()) {
+            throw std::invalid_argument{"Too many size classes"};
+        }
+        classes.push_back(std::make_unique<MemCache>(minFreeBlocks, blockSize, alignment, pageBacking));
+        if (blockSize >= maxBlockSize) {
+            break;
+        }
+    }
+
+    // Entry i is the smallest class that fits i * minBlockSize bytes.
+    classIndexes.resize((maxBlockSize + minBlockSize - 1) / minBlockSize + 1);
+    uint8_t classIndex{0};
+    for (std::size_t i{0}; i < classIndexes.size(); ++i) {
+        while (classes[classIndex]->getBlockSize() < i * minBlockSize) {
+            ++classIndex;
+        }
+        classIndexes[i] = classIndex;
+    }
+}
+
+void SizeClassMemCache::upkeep() {
+    for (auto & memCache : classes) {
+        memCache->upkeep();
+    }
+}
+
+std::size_t SizeClassMemCache::getFreeBlocksCount() {
+    std::size_t count{0};
+    for (auto & memCache : classes) {
+        count += memCache->getFreeBlocksCount();
+    }
+    return count;
+}
+
+std::size_t SizeClassMemCache::getAllocationCount() {
+    std::size_t count{0};
+    for (auto & memCache : classes) {
+        count += memCache->getAllocationCount();
+    }
+    return count;
+}
@@ -0,0 +1,108 @@
+//
+// This is a front-end over several MemCaches, one per size class.
+// The block sizes of the classes grow geometrically (they double) from
+// minBlockSize up to maxBlockSize.
+//
+// acquire(size) picks the smallest class that fits the size with one
+// lookup in a table indexed by size / minBlockSize.
+// release(block) gives the block back to the class it was carved from.
+// The block knows its MemCache through its slab, so there is no search.
+//
+// upkeep() upkeeps every class. Like MemCache::upkeep() it is meant to be
+// run periodically from one thread.
+//
+
+#ifndef SIZE_CLASS_MEM_CACHE_HPP
+#define SIZE_CLASS_MEM_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MemCache.hpp"
+
+class SizeClassMemCache {
+public:
+    // minFreeBlocks: Minimum number of free blocks of every size class.
+    // minBlockSize: Block size of the smallest class. A power of two.
+    // maxBlockSize: Largest size that can be acquired.
+    // Throws std::invalid_argument if minBlockSize is not a power of two
+    // or there would be more classes than the lookup table can address.
+    SizeClassMemCache(std::size_t minFreeBlocks, std::size_t minBlockSize, std::size_t maxBlockSize,
+                      std::size_t alignment = defaultBlockAlignment,
+                      PageBacking pageBacking = PageBacking::SmallPages);
+
+    SizeClassMemCache(const SizeClassMemCache &) = delete;
+
+    virtual ~SizeClassMemCache() = default;
+
+    void upkeep();
+
+    // Returns a block of at least size bytes.
+    // Returns nullptr if the class is empty or size is larger than maxBlockSize.
+    // The acquired block goes back to its class when it is destroyed.
+    PooledBlock<MemBlock> acquire(std::size_t size);
+
+    // Blocks that were not carved by one of the classes are given back to
+    // their owner or deleted.
+    void release(PooledBlock<MemBlock> block);
+
+    std::size_t getClassCount();
+    std::size_t getClassBlockSize(std::size_t classIndex);
+    std::size_t getFreeBlocksCount(std::size_t classIndex);
+
+    std::size_t getFreeBlocksCount();
+    std::size_t getAllocationCount();
+
+private:
+    std::size_t minBlockSize;
+    std::size_t maxBlockSize;
+
+    std::vector<std::unique_ptr<MemCache>> classes{};
+
+    // Class index for every multiple of minBlockSize up to maxBlockSize.
+    std::vector<uint8_t> classIndexes{};
+
+    MemCache * findClass(std::size_t size);
+};
+
+inline MemCache * SizeClassMemCache::findClass(std::size_t size) {
+    if (size > maxBlockSize) {
+        return nullptr;
+    }
+    return classes[classIndexes[(size + minBlockSize - 1) / minBlockSize]].get();
+}
+
+inline PooledBlock<MemBlock> SizeClassMemCache::acquire(std::size_t size) {
+    MemCache * memCache{findClass(size)};
+    if (memCache == nullptr) {
+        return nullptr;
+    }
+    return memCache->acquire();
+}
+
+inline void SizeClassMemCache::release(PooledBlock<MemBlock> block) {
+    if (block == nullptr) {
+        return;
+    }
+    // The owner is one of our classes if the class of its block size is it.
+    auto memCache = static_cast<MemCache *>(block->getOwner());
+    if (memCache == nullptr || findClass(memCache->getBlockSize()) != memCache) {
+        return;
+    }
+    memCache->release(std::move(block));
+}
+
+inline std::size_t SizeClassMemCache::getClassCount() {
+    return classes.size();
+}
+
+inline std::size_t SizeClassMemCache::getClassBlockSize(std::size_t classIndex) {
+    return classes[classIndex]->getBlockSize();
+}
+
+inline std::size_t SizeClassMemCache::getFreeBlocksCount(std::size_t classIndex) {
+    return classes[classIndex]->getFreeBlocksCount();
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <unistd.h>
+#include "BlockLayout.hpp"
+#include "SlabAllocator.hpp"
+
+void SlabAllocator::Detach::operator()(SlabAllocator * allocator) const {
+    if (allocator->detach()) {
+        delete allocator;
+    }
+}
+
+SlabAllocator::Pointer SlabAllocator::create(void * owner, std::size_t headerSize, std::size_t blockSize,
+                                             std::size_t alignment, PageBacking pageBacking,
+                                             std::size_t slabSize) {
+    if (!isPowerOfTwo(alignment)) {
+        throw std::invalid_argument{"Block alignment must be a power of two"};
+    }
+    return Pointer{new SlabAllocator{owner, headerSize, blockSize, alignment, pageBacking, slabSize}};
+}
+
+SlabAllocator::SlabAllocator(void * owner, std::size_t headerSize, std::size_t blockSize, std::size_t alignment,
+                             PageBacking pageBacking, std::size_t slabSize)
+        : owner{owner},
+          headerSize{headerSize},
+          alignment{std::max(alignment, defaultBlockAlignment)},
+          preferredPageBacking{pageBacking},
+          pageBacking{pageBacking} {
+    slotSize = blockSlotSize(headerSize, blockSize, this->alignment);
+
+    const auto pageSize = (pageBacking == PageBacking::SmallPages)
+                          ? static_cast<std::size_t>(sysconf(_SC_PAGESIZE))
+                          : hugePageSize;
+    // Leave room for aligning the first payload.
+    this->slabSize = alignUp(std::max(slabSize, slotSize + this->alignment), pageSize);
+}
+
+void * SlabAllocator::allocate(Slab *& slab) {
+    std::lock_guard<std::mutex> guard{lock};
+
+    slab = findSlabWithRoom();
+    if (slab == nullptr) {
+        slab = mapSlab();
+    }
+
+    void * block;
+    if (slab->freeSlots != nullptr) {
+        block = slab->freeSlots;
+        slab->freeSlots = *static_cast<void **>(block);
+    } else {
+        block = slab->firstBlock + slab->carvedCount * slotSize;
+        ++slab->carvedCount;
+    }
+    ++slab->liveCount;
+    ++liveBlocksCount;
+    return block;
+}
+
+void SlabAllocator::deallocate(Slab * slab, void * block) {
+    SlabAllocator * allocator{slab->allocator};
+    if (allocator->free(slab, block)) {
+        delete allocator;
+    }
+}
+
+bool SlabAllocator::free(Slab * slab, void * block) {
+    std::lock_guard<std::mutex> guard{lock};
+
+    *static_cast<void **>(block) = slab->freeSlots;
+    slab->freeSlots = block;
+    --slab->liveCount;
+    --liveBlocksCount;
+
+    if (slab->liveCount == 0) {
+        unmapSlab(slab);
+    }
+    return isDetached && slabs.empty();
+}
+
+bool SlabAllocator::detach() {
+    std::lock_guard<std::mutex> guard{lock};
+    isDetached = true;
+
+    // The blocks that are still out must not find their way back to the cache.
+    owner = nullptr;
+    for (Slab * slab : slabs) {
+        slab->owner = nullptr;
+    }
+    return slabs.empty();
+}
+
+std::size_t SlabAllocator::getSlabCount() {
+    std::lock_guard<std::mutex> guard{lock};
+    return slabs.size();
+}
+
+std::size_t SlabAllocator::getLiveBlocksCount() {
+    std::lock_guard<std::mutex> guard{lock};
+    return liveBlocksCount;
+}
+
+PageBacking SlabAllocator::getPageBacking() {
+    std::lock_guard<std::mutex> guard{lock};
+    return pageBacking;
+}
+
+Slab * SlabAllocator::findSlabWithRoom() {
+    // Prefer the fullest slab. This keeps the mostly free slabs
+    // draining so that they can be returned to the system.
+    Slab * best{nullptr};
+    for (Slab * slab : slabs) {
+        if (slab->hasRoom() && (best == nullptr || slab->liveCount > best->liveCount)) {
+            best = slab;
+        }
+    }
+    return best;
+}
+
+Slab * SlabAllocator::mapSlab() {
+    std::unique_ptr<Slab> slab{new Slab{}};
+    slab->allocator = this;
+    slab->owner = owner;
+    slab->mapping = mapPages(slabSize, preferredPageBacking);
+
+    // The first payload is aligned, its header is right before it.
+    auto memory = reinterpret_cast<std::uintptr_t>(slab->mapping.memory);
+    auto firstPayload = alignUp(memory + headerSize, alignment);
+    slab->firstBlock = reinterpret_cast<uint8_t *>(firstPayload - headerSize);
+    slab->capacity = (slab->mapping.size - (firstPayload - headerSize - memory)) / slotSize;
+    slabs.push_back(slab.get());
+
+    if (slab->mapping.backing < pageBacking) {
+        pageBacking = slab->mapping.backing;
+    }
+    return slab.release();
+}
+
+void SlabAllocator::unmapSlab(Slab * slab) {
+    slabs.erase(std::find(slabs.begin(), slabs.end(), slab));
+    unmapPages(slab->mapping);
+    delete slab;
+}
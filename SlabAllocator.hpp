@@ -0,0 +1,128 @@
+//
+// Carves memory blocks out of large contiguous slabs.
+// Blocks carved from the same slab sit next to each other in memory,
+// and growing by thousands of blocks costs a handful of mmap() calls
+// instead of thousands of malloc() calls.
+//
+// Every slab tracks how many of its blocks are alive. Freed blocks
+// are reused by later allocations and a slab that has no live blocks
+// left is returned to the system as a unit.
+//
+// The allocator is owned by a cache, but blocks may outlive the cache
+// (e.g. the user thread still holds one). So the cache detach()es the
+// allocator instead of deleting it, and the allocator deletes itself
+// when the last block of the last slab is freed.
+//
+// Every payload is aligned to the requested alignment. With cache line
+// or larger alignment the payloads never share a cache line with any
+// other block, not even with the header of the next block.
+//
+// Slabs can be backed by huge pages (see PageMemory). The allocator
+// reports the weakest backing it got, so a silent fallback to small
+// pages can be noticed.
+//
+
+#ifndef SLAB_ALLOCATOR_HPP
+#define SLAB_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BlockLayout.hpp"
+#include "PageMemory.hpp"
+
+class SlabAllocator;
+
+struct Slab {
+    SlabAllocator * allocator{nullptr};
+
+    // The cache the allocator belongs to. Lets a block find its cache.
+    void * owner{nullptr};
+
+    PageMapping mapping{};
+    uint8_t * firstBlock{nullptr};
+
+    std::size_t capacity{0};    // Number of blocks that fit into the slab.
+    std::size_t carvedCount{0}; // Number of blocks carved so far.
+    std::size_t liveCount{0};   // Number of carved blocks that are not freed.
+    void * freeSlots{nullptr};  // Freed blocks. Linked through their first word.
+
+    bool hasRoom() const;
+};
+
+inline bool Slab::hasRoom() const {
+    return (freeSlots != nullptr) || (carvedCount < capacity);
+}
+
+class SlabAllocator {
+public:
+    static const std::size_t defaultSlabSize{2 * 1024 * 1024};
+
+    struct Detach {
+        void operator()(SlabAllocator * allocator) const;
+    };
+
+    using Pointer = std::unique_ptr<SlabAllocator, Detach>;
+
+    // owner: The cache that owns the allocator. Copied into every slab.
+    // headerSize: Offset of the payload from the start of the block.
+    // blockSize: Size of the payload.
+    // alignment: Alignment of the payload. A power of two.
+    // pageBacking: The preferred backing of the slabs.
+    // Throws std::invalid_argument if the alignment is not a power of two.
+    static Pointer create(void * owner, std::size_t headerSize, std::size_t blockSize,
+                          std::size_t alignment = defaultBlockAlignment,
+                          PageBacking pageBacking = PageBacking::SmallPages,
+                          std::size_t slabSize = defaultSlabSize);
+
+    SlabAllocator(const SlabAllocator &) = delete;
+
+    // Returns the memory for one block and the slab it was carved from.
+    // Throws std::bad_alloc if no new slab can be mapped.
+    void * allocate(Slab *& slab);
+
+    static void deallocate(Slab * slab, void * block);
+
+    std::size_t getSlabCount();
+    std::size_t getLiveBlocksCount();
+    std::size_t getAlignment() const;
+
+    // The weakest backing of all slabs mapped so far. It is the
+    // preferred backing until the first slab is mapped.
+    PageBacking getPageBacking();
+
+private:
+    void * owner;
+    std::size_t headerSize;
+    std::size_t alignment;
+    std::size_t slotSize;
+    std::size_t slabSize;
+    PageBacking preferredPageBacking;
+
+    std::mutex lock{};
+    std::vector<Slab *> slabs{};
+    std::size_t liveBlocksCount{0};
+    PageBacking pageBacking;
+    bool isDetached{false};
+
+    SlabAllocator(void * owner, std::size_t headerSize, std::size_t blockSize, std::size_t alignment,
+                  PageBacking pageBacking, std::size_t slabSize);
+
+    ~SlabAllocator() = default;
+
+    Slab * findSlabWithRoom();
+    Slab * mapSlab();
+    void unmapSlab(Slab * slab);
+
+    // Returns true if the allocator must be deleted by the caller.
+    bool free(Slab * slab, void * block);
+    bool detach();
+};
+
+inline std::size_t SlabAllocator::getAlignment() const {
+    return alignment;
+}
+
+#endif
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "PlainOldData.hpp"
+#include "PooledBlock.hpp"
 
 static inline void printStressTestResult(const std::string &message,
                                          std::size_t acquireCount,
@@ -14,3 +21,82 @@ static inline void printStressTestResult(const std::string &message,
               << " (" << (allocCount * 100.0f / acquireCount) << " %)" << std::endl
               << std::endl;
 }
+
+// Prints the nanoseconds per operation of each benchmarked variant.
+static inline void printBenchmarkResult(const std::string &message,
+                                        const std::vector<std::pair<std::string, double>> &nanosecondsPerOperation)
+{
+    std::cout << message << std::endl;
+    for (const auto &result : nanosecondsPerOperation) {
+        std::cout << "\t" << result.first << " = " << result.second << " ns/op" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// Nanoseconds per acquire/release pair over all threads, i.e. the inverse of
+// the throughput. Every thread acquires and releases iterationCount times.
+template<typename MemCacheT>
+static double measureThroughputNanoseconds(MemCacheT &memCache, std::size_t threadCount, std::size_t iterationCount)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> userThreads{};
+    for (std::size_t threadIndex{0}; threadIndex < threadCount; ++threadIndex) {
+        userThreads.emplace_back([&memCache, iterationCount] {
+            for (std::size_t i{0}; i < iterationCount; ++i) {
+                PooledBlock<typename MemCacheT::Block> block{memCache.acquire()};
+                if (block != nullptr) {
+                    block->template getAs<PlainOldData>()->set(static_cast<int>(i));
+                    memCache.release(std::move(block));
+                }
+            }
+        });
+    }
+    for (std::thread &userThread : userThreads) {
+        userThread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (iterationCount * threadCount);
+}
+
+// Prints the median, the 99th percentile and the maximum of the latencies.
+// Sorts latencies.
+static inline void printLatencyResult(const std::string &message, std::vector<double> &nanosecondLatencies)
+{
+    if (nanosecondLatencies.empty()) {
+        return;
+    }
+    std::sort(nanosecondLatencies.begin(), nanosecondLatencies.end());
+    auto percentile = [&nanosecondLatencies](double p) {
+        return nanosecondLatencies[static_cast<std::size_t>(p * (nanosecondLatencies.size() - 1))];
+    };
+    std::cout << message << std::endl
+              << "\tsamples = " << nanosecondLatencies.size() << std::endl
+              << "\tp50 = " << percentile(0.50) << " ns" << std::endl
+              << "\tp99 = " << percentile(0.99) << " ns" << std::endl
+              << "\tp99.9 = " << percentile(0.999) << " ns" << std::endl
+              << "\tp99.99 = " << percentile(0.9999) << " ns" << std::endl
+              << "\tmax = " << nanosecondLatencies.back() << " ns" << std::endl
+              << std::endl;
+}
+
+// Keeps the most recent capacity latencies, so that a long run records into
+// a fixed amount of memory.
+class LatencySample {
+public:
+    explicit LatencySample(std::size_t capacity) : latencies(capacity) {}
+
+    void add(double nanosecondLatency) {
+        latencies[addedCount % latencies.size()] = nanosecondLatency;
+        ++addedCount;
+    }
+
+    // Sorts the sample.
+    void print(const std::string &message) {
+        latencies.resize(std::min(addedCount, latencies.size()));
+        printLatencyResult(message, latencies);
+    }
+
+private:
+    std::vector<double> latencies;
+    std::size_t addedCount{0};
+};
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <thread>
+#include "StripedMemCache.hpp"
+
+std::atomic<std::size_t> StripedMemCache::threadCount{0};
+thread_local std::size_t StripedMemCache::threadIndex{0};
+
+StripedMemCache::StripedMemCache(std::size_t minFreeBlocks, std::size_t blockSize, std::size_t shardCount,
+                                 std::size_t alignment, PageBacking pageBacking)
+        : blockSize{blockSize} {
+    if (shardCount == 0) {
+        shardCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Every shard gets its share of minFreeBlocks. The first ones get the remainder.
+    for (std::size_t i{0}; i < shardCount; ++i) {
+        const std::size_t shardMinFreeBlocks{minFreeBlocks / shardCount + ((i < minFreeBlocks % shardCount) ? 1 : 0)};
+        shards.push_back(std::make_unique<MemCache>(shardMinFreeBlocks, blockSize, alignment, pageBacking));
+    }
+}
+
+void StripedMemCache::upkeep() {
+    for (auto & shard : shards) {
+        shard->upkeep();
+    }
+}
+
+std::size_t StripedMemCache::getFreeBlocksCount() {
+    std::size_t count{0};
+    for (auto & shard : shards) {
+        count += shard->getFreeBlocksCount();
+    }
+    return count;
+}
+
+std::size_t StripedMemCache::getAllocationCount() {
+    std::size_t count{0};
+    for (auto & shard : shards) {
+        count += shard->getAllocationCount();
+    }
+    return count;
+}
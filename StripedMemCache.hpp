@@ -0,0 +1,139 @@
+//
+// This is a front-end over several MemCaches (shards) for many user threads.
+// Every user thread is assigned a home shard when it first uses a
+// StripedMemCache (round robin), so threads rarely contend for the same
+// mutex.
+//
+// acquire() takes a block from the home shard. If that is empty it steals
+// from the neighbor shards, in order. release() gives the block back to the
+// shard that carved it, like a block that is only dropped (see PooledBlock),
+// so every shard only ever holds its own blocks.
+//
+// upkeep() upkeeps every shard to its share of minFreeBlocks. Like
+// MemCache::upkeep() it is meant to be run periodically from one thread.
+//
+
+#ifndef STRIPED_MEM_CACHE_HPP
+#define STRIPED_MEM_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "MemCache.hpp"
+
+class StripedMemCache {
+public:
+    using Block = MemBlock;
+
+    // shardCount: Number of independently locked shards. 0 means one per
+    //   hardware thread.
+    StripedMemCache(std::size_t minFreeBlocks, std::size_t blockSize, std::size_t shardCount = 0,
+                    std::size_t alignment = defaultBlockAlignment,
+                    PageBacking pageBacking = PageBacking::SmallPages);
+
+    StripedMemCache(const StripedMemCache &) = delete;
+
+    virtual ~StripedMemCache() = default;
+
+    void upkeep();
+
+    // The acquired block goes back to its shard when it is destroyed.
+    PooledBlock<MemBlock> acquire();
+
+    // Blocks of other caches or without a cache are given back to their
+    // owner or deleted.
+    void release(PooledBlock<MemBlock> block);
+
+    std::size_t getShardCount();
+    std::size_t getFreeBlocksCount(std::size_t shardIndex);
+    // The shard that acquire() and release() of the calling thread use.
+    std::size_t getHomeShardIndex();
+
+    std::size_t getFreeBlocksCount();
+    std::size_t getAllocationCount();
+    // Acquires served by a neighbor shard because the home shard was empty.
+    std::size_t getStealCount();
+    std::size_t getBlockSize();
+
+private:
+    std::size_t blockSize;
+
+    std::vector<std::unique_ptr<MemCache>> shards{};
+
+    alignas(cacheLineSize) std::atomic<std::size_t> stealCount{0};
+
+    static std::atomic<std::size_t> threadCount;
+    static thread_local std::size_t threadIndex;
+
+    static std::size_t getThreadIndex();
+
+    bool isShard(const MemCache * memCache);
+};
+
+inline std::size_t StripedMemCache::getThreadIndex() {
+    // 0 means not assigned yet.
+    if (threadIndex == 0) {
+        threadIndex = threadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    return threadIndex - 1;
+}
+
+inline bool StripedMemCache::isShard(const MemCache * memCache) {
+    for (const std::unique_ptr<MemCache> & shard : shards) {
+        if (shard.get() == memCache) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline std::size_t StripedMemCache::getHomeShardIndex() {
+    return getThreadIndex() % shards.size();
+}
+
+inline PooledBlock<MemBlock> StripedMemCache::acquire() {
+    const std::size_t homeShardIndex{getHomeShardIndex()};
+    PooledBlock<MemBlock> block{shards[homeShardIndex]->acquire()};
+    if (block != nullptr) {
+        return block;
+    }
+    for (std::size_t i{1}; i < shards.size(); ++i) {
+        block = shards[(homeShardIndex + i) % shards.size()]->acquire();
+        if (block != nullptr) {
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+    return nullptr;
+}
+
+inline void StripedMemCache::release(PooledBlock<MemBlock> block) {
+    if (block == nullptr) {
+        return;
+    }
+    // A shard only has room for the blocks it carved (see MemCache::reserveFreeBlocks()).
+    auto owner = static_cast<MemCache *>(block->getOwner());
+    if (owner == nullptr || !isShard(owner)) {
+        return;
+    }
+    owner->release(std::move(block));
+}
+
+inline std::size_t StripedMemCache::getShardCount() {
+    return shards.size();
+}
+
+inline std::size_t StripedMemCache::getFreeBlocksCount(std::size_t shardIndex) {
+    return shards[shardIndex]->getFreeBlocksCount();
+}
+
+inline std::size_t StripedMemCache::getStealCount() {
+    return stealCount.load(std::memory_order_relaxed);
+}
+
+inline std::size_t StripedMemCache::getBlockSize() {
+    return blockSize;
+}
+
+#endif
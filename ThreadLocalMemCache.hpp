@@ -0,0 +1,335 @@
+//
+// A per-thread front-end for a cache (MemCache or LockFreeLinkedMemCache).
+//
+// Every thread keeps a small stack of at most localCapacity blocks for
+// itself. acquire() and release() work on that stack and touch no shared
+// atomic or mutex. Only when the stack runs empty (or full) are batchSize
+// blocks moved from (or to) the cache with one acquireBatch()
+// (or releaseBatch()).
+//
+// The blocks of a thread go back to the cache when the thread exits, when
+// the thread calls flush() and when the front-end is destroyed. So destroy
+// the front-end before the cache. Blocks sitting in a local stack are not
+// free blocks of the cache, so minFreeBlocks should leave room for them.
+//
+// getStats() tells how many acquires were served by the local stacks.
+// Use it to tune localCapacity and batchSize.
+//
+
+#ifndef THREAD_LOCAL_MEM_CACHE_HPP
+#define THREAD_LOCAL_MEM_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "LockFreeLinkedMemCache.hpp"
+#include "MemCache.hpp"
+#include "PooledBlock.hpp"
+
+struct ThreadLocalMemCacheStats {
+    std::size_t acquireCount{0};
+    // Acquires served by the local stack without going to the cache.
+    std::size_t localHitCount{0};
+    std::size_t refillCount{0};
+    std::size_t flushCount{0};
+
+    double getLocalHitRate() const;
+};
+
+inline double ThreadLocalMemCacheStats::getLocalHitRate() const {
+    return (acquireCount == 0) ? 0.0 : static_cast<double>(localHitCount) / acquireCount;
+}
+
+template<typename MemCacheT>
+class ThreadLocalMemCache {
+public:
+    using Block = typename MemCacheT::Block;
+
+    static constexpr std::size_t defaultLocalCapacity{64};
+
+    // localCapacity: The most blocks a thread keeps for itself.
+    // batchSize: The number of blocks moved at once between a local stack
+    //   and the cache. 0 means half of localCapacity.
+    explicit ThreadLocalMemCache(MemCacheT & memCache, std::size_t localCapacity = defaultLocalCapacity,
+                                 std::size_t batchSize = 0);
+
+    ThreadLocalMemCache(const ThreadLocalMemCache &) = delete;
+
+    // Gives the blocks of every thread back to the cache.
+    // No thread may use the front-end meanwhile.
+    virtual ~ThreadLocalMemCache();
+
+    PooledBlock<Block> acquire();
+
+    // Blocks of other caches or without a cache are given back to their
+    // owner or deleted.
+    void release(PooledBlock<Block> block);
+
+    // Gives the blocks of the calling thread back to the cache.
+    void flush();
+
+    // The sum over every thread that has used the front-end.
+    ThreadLocalMemCacheStats getStats();
+
+    std::size_t getLocalCapacity() const;
+    std::size_t getBatchSize() const;
+
+private:
+    struct LocalCache;
+
+    // Shared by the front-end and the local caches of the threads, so a
+    // thread exiting after the front-end is gone still finds it.
+    struct Registry {
+        std::mutex lock{};
+        bool isAlive{true};
+        std::vector<LocalCache *> localCaches{};
+        ThreadLocalMemCacheStats exitedThreadsStats{};
+    };
+
+    // Owned by one thread. The counters are atomic only so that getStats()
+    // can read them. Only the owner thread writes them.
+    struct LocalCache {
+        std::shared_ptr<Registry> registry;
+        std::vector<PooledBlock<Block>> blocks{};
+        std::vector<PooledBlock<Block>> batch{};
+
+        std::atomic<std::size_t> acquireCount{0};
+        std::atomic<std::size_t> localHitCount{0};
+        std::atomic<std::size_t> refillCount{0};
+        std::atomic<std::size_t> flushCount{0};
+
+        explicit LocalCache(std::shared_ptr<Registry> registry) : registry{std::move(registry)} {}
+
+        LocalCache(const LocalCache &) = delete;
+
+        // Runs when the owner thread exits.
+        ~LocalCache();
+
+        void addStatsTo(ThreadLocalMemCacheStats & stats) const;
+    };
+
+    MemCacheT & memCache;
+    std::size_t localCapacity;
+    std::size_t batchSize;
+    std::shared_ptr<Registry> registry;
+
+    static thread_local std::vector<std::unique_ptr<LocalCache>> threadLocalCaches;
+
+    LocalCache & getLocalCache();
+    LocalCache & createLocalCache();
+
+    void refill(LocalCache & localCache);
+    void flush(LocalCache & localCache, std::size_t count);
+
+    static void acquireBatch(MemCache & memCache, std::vector<PooledBlock<MemBlock>> & blocks, std::size_t count);
+    static void acquireBatch(LockFreeLinkedMemCache & memCache, std::vector<PooledBlock<LinkedMemBlock>> & blocks,
+                             std::size_t count);
+    static void releaseBatch(MemCache & memCache, std::vector<PooledBlock<MemBlock>> & blocks);
+    static void releaseBatch(LockFreeLinkedMemCache & memCache, std::vector<PooledBlock<LinkedMemBlock>> & blocks);
+
+    static void increment(std::atomic<std::size_t> & counter);
+};
+
+template<typename MemCacheT>
+thread_local std::vector<std::unique_ptr<typename ThreadLocalMemCache<MemCacheT>::LocalCache>>
+        ThreadLocalMemCache<MemCacheT>::threadLocalCaches{};
+
+template<typename MemCacheT>
+ThreadLocalMemCache<MemCacheT>::ThreadLocalMemCache(MemCacheT & memCache, std::size_t localCapacity,
+                                                    std::size_t batchSize)
+        : memCache{memCache},
+          localCapacity{localCapacity},
+          batchSize{(batchSize == 0) ? localCapacity / 2 : batchSize},
+          registry{std::make_shared<Registry>()} {
+    if (this->batchSize == 0 || this->batchSize > localCapacity) {
+        throw std::invalid_argument{"Batch size must be between 1 and the local capacity"};
+    }
+}
+
+template<typename MemCacheT>
+ThreadLocalMemCache<MemCacheT>::~ThreadLocalMemCache() {
+    std::lock_guard<std::mutex> guard{registry->lock};
+    for (LocalCache * localCache : registry->localCaches) {
+        releaseBatch(memCache, localCache->blocks);
+    }
+    registry->isAlive = false;
+    registry->localCaches.clear();
+}
+
+template<typename MemCacheT>
+inline PooledBlock<typename MemCacheT::Block> ThreadLocalMemCache<MemCacheT>::acquire() {
+    LocalCache & localCache{getLocalCache()};
+    increment(localCache.acquireCount);
+    if (localCache.blocks.empty()) {
+        refill(localCache);
+        if (localCache.blocks.empty()) {
+            return nullptr;
+        }
+    } else {
+        increment(localCache.localHitCount);
+    }
+    PooledBlock<Block> block{std::move(localCache.blocks.back())};
+    localCache.blocks.pop_back();
+    return block;
+}
+
+template<typename MemCacheT>
+inline void ThreadLocalMemCache<MemCacheT>::release(PooledBlock<Block> block) {
+    // Blocks of other caches go back to their owner when block is destroyed.
+    if (block == nullptr || block->getOwner() != &memCache) {
+        return;
+    }
+    LocalCache & localCache{getLocalCache()};
+    if (localCache.blocks.size() >= localCapacity) {
+        flush(localCache, batchSize);
+    }
+    localCache.blocks.push_back(std::move(block));
+}
+
+template<typename MemCacheT>
+void ThreadLocalMemCache<MemCacheT>::flush() {
+    LocalCache & localCache{getLocalCache()};
+    flush(localCache, localCache.blocks.size());
+}
+
+template<typename MemCacheT>
+ThreadLocalMemCacheStats ThreadLocalMemCache<MemCacheT>::getStats() {
+    std::lock_guard<std::mutex> guard{registry->lock};
+    ThreadLocalMemCacheStats stats{registry->exitedThreadsStats};
+    for (const LocalCache * localCache : registry->localCaches) {
+        localCache->addStatsTo(stats);
+    }
+    return stats;
+}
+
+template<typename MemCacheT>
+inline std::size_t ThreadLocalMemCache<MemCacheT>::getLocalCapacity() const {
+    return localCapacity;
+}
+
+template<typename MemCacheT>
+inline std::size_t ThreadLocalMemCache<MemCacheT>::getBatchSize() const {
+    return batchSize;
+}
+
+template<typename MemCacheT>
+inline typename ThreadLocalMemCache<MemCacheT>::LocalCache & ThreadLocalMemCache<MemCacheT>::getLocalCache() {
+    // A thread uses only a few front-ends, so a linear search is enough.
+    // The local cache keeps the registry alive, so its address is not reused.
+    for (const std::unique_ptr<LocalCache> & localCache : threadLocalCaches) {
+        if (localCache->registry == registry) {
+            return *localCache;
+        }
+    }
+    return createLocalCache();
+}
+
+template<typename MemCacheT>
+typename ThreadLocalMemCache<MemCacheT>::LocalCache & ThreadLocalMemCache<MemCacheT>::createLocalCache() {
+    // Drop the local caches of front-ends that are gone.
+    threadLocalCaches.erase(
+            std::remove_if(threadLocalCaches.begin(), threadLocalCaches.end(),
+                           [](const std::unique_ptr<LocalCache> & localCache) {
+                               std::lock_guard<std::mutex> guard{localCache->registry->lock};
+                               return !localCache->registry->isAlive;
+                           }),
+            threadLocalCaches.end());
+
+    auto localCache = std::make_unique<LocalCache>(registry);
+    // Neither acquire() nor release() allocates memory afterwards.
+    localCache->blocks.reserve(localCapacity + 1);
+    localCache->batch.reserve(batchSize);
+    {
+        std::lock_guard<std::mutex> guard{registry->lock};
+        registry->localCaches.push_back(localCache.get());
+    }
+    threadLocalCaches.push_back(std::move(localCache));
+    return *threadLocalCaches.back();
+}
+
+template<typename MemCacheT>
+void ThreadLocalMemCache<MemCacheT>::refill(LocalCache & localCache) {
+    increment(localCache.refillCount);
+    acquireBatch(memCache, localCache.blocks, batchSize);
+}
+
+template<typename MemCacheT>
+void ThreadLocalMemCache<MemCacheT>::flush(LocalCache & localCache, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    increment(localCache.flushCount);
+    // The blocks at the bottom of the stack are the coldest ones.
+    auto first = localCache.blocks.begin();
+    std::move(first, first + count, std::back_inserter(localCache.batch));
+    localCache.blocks.erase(first, first + count);
+    releaseBatch(memCache, localCache.batch);
+}
+
+template<typename MemCacheT>
+ThreadLocalMemCache<MemCacheT>::LocalCache::~LocalCache() {
+    std::lock_guard<std::mutex> guard{registry->lock};
+    if (registry->isAlive) {
+        addStatsTo(registry->exitedThreadsStats);
+        auto & localCaches = registry->localCaches;
+        localCaches.erase(std::remove(localCaches.begin(), localCaches.end(), this), localCaches.end());
+    }
+    // The blocks go back to their cache one by one (see PooledBlock).
+    // Under the lock, so the front-end cannot flush them at the same time.
+    blocks.clear();
+}
+
+template<typename MemCacheT>
+void ThreadLocalMemCache<MemCacheT>::LocalCache::addStatsTo(ThreadLocalMemCacheStats & stats) const {
+    stats.acquireCount += acquireCount.load(std::memory_order_relaxed);
+    stats.localHitCount += localHitCount.load(std::memory_order_relaxed);
+    stats.refillCount += refillCount.load(std::memory_order_relaxed);
+    stats.flushCount += flushCount.load(std::memory_order_relaxed);
+}
+
+template<typename MemCacheT>
+inline void ThreadLocalMemCache<MemCacheT>::acquireBatch(MemCache & memCache,
+                                                         std::vector<PooledBlock<MemBlock>> & blocks,
+                                                         std::size_t count) {
+    memCache.acquireBatch(blocks, count);
+}
+
+template<typename MemCacheT>
+inline void ThreadLocalMemCache<MemCacheT>::acquireBatch(LockFreeLinkedMemCache & memCache,
+                                                         std::vector<PooledBlock<LinkedMemBlock>> & blocks,
+                                                         std::size_t count) {
+    LinkedMemBlockChain chain{memCache.acquireBatch(count)};
+    while (!chain.isEmpty()) {
+        blocks.push_back(chain.popFromFront());
+    }
+}
+
+template<typename MemCacheT>
+inline void ThreadLocalMemCache<MemCacheT>::releaseBatch(MemCache & memCache,
+                                                         std::vector<PooledBlock<MemBlock>> & blocks) {
+    memCache.releaseBatch(blocks);
+}
+
+template<typename MemCacheT>
+inline void ThreadLocalMemCache<MemCacheT>::releaseBatch(LockFreeLinkedMemCache & memCache,
+                                                         std::vector<PooledBlock<LinkedMemBlock>> & blocks) {
+    LinkedMemBlockChain chain{};
+    for (PooledBlock<LinkedMemBlock> & block : blocks) {
+        chain.pushToFront(std::move(block));
+    }
+    blocks.clear();
+    memCache.releaseBatch(std::move(chain));
+}
+
+template<typename MemCacheT>
+inline void ThreadLocalMemCache<MemCacheT>::increment(std::atomic<std::size_t> & counter) {
+    // Only the owner thread writes the counter, so no read-modify-write is needed.
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cerrno>
+#include <future>
+#include <stdexcept>
+#include <system_error>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "UpkeepService.hpp"
+
+constexpr std::chrono::milliseconds UpkeepService::minInterval;
+constexpr std::chrono::milliseconds UpkeepService::maxInterval;
+constexpr std::chrono::milliseconds UpkeepService::initialInterval;
+
+// The id of the wake fd in the epoll set. Entries start at 1.
+static constexpr std::uint64_t wakeId{0};
+
+UpkeepService::UpkeepService(std::size_t threadCount, const std::vector<unsigned> & cpus,
+                             std::optional<int> niceness) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (unsigned cpu : cpus) {
+        if (cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("UpkeepService: No such CPU");
+        }
+        CPU_SET(cpu, &cpuSet);
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        throw std::system_error(errno, std::system_category(), "UpkeepService: epoll_create1");
+    }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = wakeId;
+    if (wakeFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) != 0) {
+        const int error{errno};
+        stop();
+        throw std::system_error(error, std::system_category(), "UpkeepService: eventfd");
+    }
+
+    // Every thread sets itself up and reports the errno of the first failure.
+    std::vector<std::future<int>> setupResults{};
+    try {
+        for (std::size_t i{0}; i < std::max<std::size_t>(1, threadCount); ++i) {
+            std::promise<int> setupResult{};
+            setupResults.push_back(setupResult.get_future());
+            threads.emplace_back([this, cpuSet, isPinned = !cpus.empty(), niceness,
+                                  setupResult = std::move(setupResult)]() mutable {
+                int error{0};
+                if (isPinned) {
+                    error = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+                }
+                // The niceness of a Linux thread is set through its thread id.
+                if (error == 0 && niceness.has_value()
+                    && setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), *niceness) != 0) {
+                    error = errno;
+                }
+                setupResult.set_value(error);
+                if (error == 0) {
+                    run();
+                }
+            });
+        }
+    } catch (...) {
+        // E.g. std::system_error if no more threads can be started. The
+        // destructor does not run, so join the started ones here.
+        stop();
+        throw;
+    }
+    for (std::future<int> & setupResult : setupResults) {
+        const int error{setupResult.get()};
+        if (error != 0) {
+            stop();
+            throw std::system_error(error, std::system_category(), "UpkeepService: Thread setup");
+        }
+    }
+}
+
+UpkeepService::~UpkeepService() {
+    stop();
+}
+
+void UpkeepService::stop() {
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        isStopping = true;
+    }
+    // Never drained from now on, so every thread wakes up.
+    wake();
+    for (std::thread & thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+    if (wakeFd >= 0) {
+        close(wakeFd);
+        wakeFd = -1;
+    }
+    if (epollFd >= 0) {
+        close(epollFd);
+        epollFd = -1;
+    }
+}
+
+void UpkeepService::wake() {
+    if (wakeFd >= 0) {
+        const std::uint64_t value{1};
+        (void) write(wakeFd, &value, sizeof(value));
+    }
+}
+
+void UpkeepService::addEntry(std::unique_ptr<Entry> entry) {
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        if (findEntry(entry->getCache()) != nullptr) {
+            return;
+        }
+        entry->id = nextEntryId++;
+        entry->upkeptFreeBlocksCount = entry->getFreeBlocksCount();
+        entry->failedAcquireCount = entry->getFailedAcquireCount();
+        // Upkept right away.
+        entry->nextUpkeepTime = std::chrono::steady_clock::now();
+        const int fd{entry->getFd()};
+        if (fd >= 0) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = entry->id;
+            // Without the fd the cache is still upkept at its interval.
+            (void) epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        }
+        entries.push_back(std::move(entry));
+    }
+    wake();
+}
+
+bool UpkeepService::removeEntry(const void * cache) {
+    std::unique_lock<std::mutex> guard{lock};
+    upkeepFinished.wait(guard, [this, cache] {
+        Entry * entry{findEntry(cache)};
+        return entry == nullptr || !entry->isBusy;
+    });
+    auto found = std::find_if(entries.begin(), entries.end(), [cache](const std::unique_ptr<Entry> & entry) {
+        return entry->getCache() == cache;
+    });
+    if (found == entries.end()) {
+        return false;
+    }
+    const int fd{(*found)->getFd()};
+    if (fd >= 0) {
+        (void) epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    entries.erase(found);
+    return true;
+}
+
+std::chrono::nanoseconds UpkeepService::getEntryInterval(const void * cache) {
+    std::lock_guard<std::mutex> guard{lock};
+    Entry * entry{findEntry(cache)};
+    return (entry != nullptr) ? entry->interval : std::chrono::nanoseconds::zero();
+}
+
+std::size_t UpkeepService::getThreadCount() {
+    return threads.size();
+}
+
+std::size_t UpkeepService::getCacheCount() {
+    std::lock_guard<std::mutex> guard{lock};
+    return entries.size();
+}
+
+std::size_t UpkeepService::getUpkeepCount() {
+    std::lock_guard<std::mutex> guard{lock};
+    return upkeepCount;
+}
+
+void UpkeepService::run() {
+    constexpr int maxEventCount{16};
+    epoll_event events[maxEventCount];
+    int timeout{0};
+
+    std::unique_lock<std::mutex> guard{lock};
+    while (!isStopping) {
+        guard.unlock();
+        const int eventCount{epoll_wait(epollFd, events, maxEventCount, timeout)};
+        guard.lock();
+
+        for (int i{0}; i < eventCount; ++i) {
+            if (events[i].data.u64 == wakeId) {
+                if (!isStopping) {
+                    std::uint64_t value;
+                    (void) read(wakeFd, &value, sizeof(value));
+                }
+                continue;
+            }
+            // The entry may have been removed since.
+            Entry * entry{findEntry(events[i].data.u64)};
+            if (entry != nullptr && entry->takeSignal()) {
+                entry->isSignaled = true;
+            }
+        }
+        if (isStopping) {
+            break;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        Entry * entry{pickEntry(now)};
+        if (entry == nullptr) {
+            timeout = getTimeout(now);
+            continue;
+        }
+        // There may be more due entries, so look again right away.
+        timeout = 0;
+
+        const bool wasSignaled{entry->isSignaled};
+        entry->isSignaled = false;
+        entry->isBusy = true;
+        guard.unlock();
+        const double fillRatio{entry->getFillRatio()};
+        const std::size_t freeBlocksCount{entry->getFreeBlocksCount()};
+        const std::size_t failedAcquireCount{entry->getFailedAcquireCount()};
+        entry->upkeep();
+        const std::size_t upkeptFreeBlocksCount{entry->getFreeBlocksCount()};
+        guard.lock();
+        entry->isBusy = false;
+        ++upkeepCount;
+        const bool wasIdle{freeBlocksCount >= entry->upkeptFreeBlocksCount
+                           && failedAcquireCount == entry->failedAcquireCount};
+        entry->upkeptFreeBlocksCount = upkeptFreeBlocksCount;
+        entry->failedAcquireCount = failedAcquireCount;
+        adaptInterval(*entry, wasSignaled, fillRatio, wasIdle);
+        upkeepFinished.notify_all();
+    }
+}
+
+UpkeepService::Entry * UpkeepService::findEntry(const void * cache) {
+    for (auto & entry : entries) {
+        if (entry->getCache() == cache) {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+UpkeepService::Entry * UpkeepService::findEntry(std::uint64_t id) {
+    for (auto & entry : entries) {
+        if (entry->id == id) {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+UpkeepService::Entry * UpkeepService::pickEntry(std::chrono::steady_clock::time_point now) {
+    Entry * mostUrgentEntry{nullptr};
+    double lowestFillRatio{0.0};
+    for (auto & entry : entries) {
+        if (entry->isBusy || (!entry->isSignaled && entry->nextUpkeepTime > now)) {
+            continue;
+        }
+        const double fillRatio{entry->getFillRatio()};
+        if (mostUrgentEntry == nullptr || fillRatio < lowestFillRatio) {
+            mostUrgentEntry = entry.get();
+            lowestFillRatio = fillRatio;
+        }
+    }
+    return mostUrgentEntry;
+}
+
+int UpkeepService::getTimeout(std::chrono::steady_clock::time_point now) {
+    std::chrono::nanoseconds timeout{maxInterval};
+    for (auto & entry : entries) {
+        if (!entry->isBusy) {
+            timeout = std::min<std::chrono::nanoseconds>(timeout, entry->nextUpkeepTime - now);
+        }
+    }
+    // Rounded up, so that the entry is due when epoll_wait() returns.
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(
+            std::max(timeout, std::chrono::nanoseconds::zero())).count());
+}
+
+void UpkeepService::adaptInterval(Entry & entry, bool wasSignaled, double fillRatio, bool wasIdle) {
+    if (wasSignaled || fillRatio < 0.5) {
+        entry.interval = std::max<std::chrono::nanoseconds>(minInterval, entry.interval / 2);
+    } else if (wasIdle) {
+        entry.interval = std::min<std::chrono::nanoseconds>(maxInterval, entry.interval * 2);
+    }
+    entry.nextUpkeepTime = std::chrono::steady_clock::now() + entry.interval;
+}
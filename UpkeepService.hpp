@@ -0,0 +1,190 @@
+//
+// Background threads that run upkeep() of any number of caches.
+//
+// A cache is added with add() and removed with remove(). Any cache with
+// upkeep(), getFreeBlocksCount(), getMinFreeBlocks(), getFailedAcquireCount(),
+// waitForUpkeepNeeded() and getUpkeepNeededFd() works, e.g. MemCache,
+// LockFreeLinkedMemCache and FixedMemCache. The upkeep() of one cache is never run by two service
+// threads at once.
+//
+// A cache is upkept when its interval has passed or when it signals that
+// its free blocks run low (see MemCache::setLowWatermark()). The service
+// threads sleep in epoll_wait() on the signals in between. Of the caches
+// that are due, the one with the fewest free blocks relative to its
+// minFreeBlocks goes first.
+//
+// The interval of every cache adapts to its demand, between minInterval
+// and maxInterval. It halves when the cache signaled or was found below
+// half of minFreeBlocks, and doubles when the cache saw no demand since the
+// last upkeep(): its free blocks did not drop below what upkeep() left
+// behind and no acquire failed. The fill ratio alone does not show that: a
+// cache that shrinks only above a high watermark stays above minFreeBlocks
+// while it is busy.
+//
+// The service does not own the caches or their blocks. A cache must be
+// removed, or the service destroyed, before the cache is destroyed.
+// remove() and the destructor wait for a running upkeep() to finish, so
+// afterwards no service thread touches the cache.
+//
+
+#ifndef UPKEEP_SERVICE_HPP
+#define UPKEEP_SERVICE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class UpkeepService {
+public:
+    static constexpr std::chrono::milliseconds minInterval{1};
+    static constexpr std::chrono::milliseconds maxInterval{100};
+    static constexpr std::chrono::milliseconds initialInterval{10};
+
+    // threadCount: Number of service threads. At least 1.
+    // cpus: The CPUs the service threads may run on. Empty means any.
+    // niceness: The nice value of the service threads (see setpriority()).
+    //   Empty keeps the niceness of the process. Lower than that needs
+    //   CAP_SYS_NICE.
+    // Throws std::system_error if the threads cannot be set up.
+    explicit UpkeepService(std::size_t threadCount = 1, const std::vector<unsigned> & cpus = {},
+                           std::optional<int> niceness = std::nullopt);
+
+    UpkeepService(const UpkeepService &) = delete;
+
+    // Waits for the running upkeep() calls to finish.
+    virtual ~UpkeepService();
+
+    // Adding a cache twice has no effect.
+    template<typename MemCacheT>
+    void add(MemCacheT & memCache);
+
+    // Returns after the running upkeep() of the cache (if any) finished.
+    // Returns false if the cache was not added.
+    template<typename MemCacheT>
+    bool remove(MemCacheT & memCache);
+
+    std::size_t getThreadCount();
+    std::size_t getCacheCount();
+    // The current interval of the cache. Zero if the cache was not added.
+    template<typename MemCacheT>
+    std::chrono::nanoseconds getInterval(MemCacheT & memCache);
+    // upkeep() calls made by the service, over all caches.
+    std::size_t getUpkeepCount();
+
+private:
+    // The caches are kept behind this interface, so that one service can
+    // upkeep different kinds of caches.
+    struct Entry {
+        virtual ~Entry() = default;
+
+        virtual const void * getCache() = 0;
+        virtual void upkeep() = 0;
+        // Free blocks relative to minFreeBlocks.
+        virtual double getFillRatio() = 0;
+        virtual std::size_t getFreeBlocksCount() = 0;
+        virtual std::size_t getFailedAcquireCount() = 0;
+        // Returns true if the cache signaled, and clears the signal.
+        virtual bool takeSignal() = 0;
+        virtual int getFd() = 0;
+
+        std::uint64_t id{0};
+        std::chrono::nanoseconds interval{initialInterval};
+        std::chrono::steady_clock::time_point nextUpkeepTime{};
+        // The free blocks left behind by the last upkeep(), and the failed
+        // acquires before it.
+        std::size_t upkeptFreeBlocksCount{0};
+        std::size_t failedAcquireCount{0};
+        bool isSignaled{false};
+        bool isBusy{false};
+    };
+
+    template<typename MemCacheT>
+    struct CacheEntry final : Entry {
+        explicit CacheEntry(MemCacheT & memCache) : memCache{memCache} {}
+
+        const void * getCache() override {
+            return &memCache;
+        }
+
+        void upkeep() override {
+            memCache.upkeep();
+        }
+
+        double getFillRatio() override {
+            const std::size_t minFreeBlocks{memCache.getMinFreeBlocks()};
+            return (minFreeBlocks > 0) ? static_cast<double>(memCache.getFreeBlocksCount()) / minFreeBlocks : 1.0;
+        }
+
+        std::size_t getFreeBlocksCount() override {
+            return memCache.getFreeBlocksCount();
+        }
+
+        std::size_t getFailedAcquireCount() override {
+            return memCache.getFailedAcquireCount();
+        }
+
+        bool takeSignal() override {
+            return memCache.waitForUpkeepNeeded(std::chrono::nanoseconds::zero());
+        }
+
+        int getFd() override {
+            return memCache.getUpkeepNeededFd();
+        }
+
+        MemCacheT & memCache;
+    };
+
+    std::mutex lock{};
+    // Notified when an upkeep() finished.
+    std::condition_variable upkeepFinished{};
+    std::vector<std::unique_ptr<Entry>> entries{};
+    std::uint64_t nextEntryId{1};
+    std::size_t upkeepCount{0};
+    bool isStopping{false};
+
+    int epollFd{-1};
+    // Readable when the service threads have to look at the entries again.
+    int wakeFd{-1};
+
+    std::vector<std::thread> threads{};
+
+    void addEntry(std::unique_ptr<Entry> entry);
+    bool removeEntry(const void * cache);
+    std::chrono::nanoseconds getEntryInterval(const void * cache);
+
+    void run();
+    void stop();
+    void wake();
+
+    // Call with the lock held.
+    Entry * findEntry(const void * cache);
+    Entry * findEntry(std::uint64_t id);
+    // The most urgent entry that is due, or nullptr.
+    Entry * pickEntry(std::chrono::steady_clock::time_point now);
+    // Milliseconds until the next entry is due, for epoll_wait().
+    int getTimeout(std::chrono::steady_clock::time_point now);
+    void adaptInterval(Entry & entry, bool wasSignaled, double fillRatio, bool wasIdle);
+};
+
+template<typename MemCacheT>
+void UpkeepService::add(MemCacheT & memCache) {
+    addEntry(std::make_unique<CacheEntry<MemCacheT>>(memCache));
+}
+
+template<typename MemCacheT>
+bool UpkeepService::remove(MemCacheT & memCache) {
+    return removeEntry(&memCache);
+}
+
+template<typename MemCacheT>
+std::chrono::nanoseconds UpkeepService::getInterval(MemCacheT & memCache) {
+    return getEntryInterval(&memCache);
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "UpkeepSignal.hpp"
+
+UpkeepSignal::~UpkeepSignal() {
+    const int currentFd{fd.load(std::memory_order_relaxed)};
+    if (currentFd >= 0) {
+        close(currentFd);
+    }
+}
+
+bool UpkeepSignal::waitFor(std::chrono::nanoseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    WaitQueue::Waiter waiter{waiters};
+    for (;;) {
+        const std::uint32_t ticket{waiter.getTicket()};
+        // Drained on every check, not only when raised. Otherwise a write of
+        // a raise() that was already taken would keep the fd readable.
+        const int currentFd{fd.load(std::memory_order_acquire)};
+        if (currentFd >= 0) {
+            std::uint64_t value;
+            // Non-blocking. Fails if nothing was written.
+            (void) read(currentFd, &value, sizeof(value));
+        }
+        if (isRaised.exchange(false, std::memory_order_seq_cst)) {
+            return true;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        waiter.wait(ticket, deadline - now);
+    }
+}
+
+int UpkeepSignal::getFd() {
+    int currentFd{fd.load(std::memory_order_acquire)};
+    if (currentFd >= 0) {
+        return currentFd;
+    }
+    const int newFd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)};
+    if (newFd < 0) {
+        return -1;
+    }
+    if (!fd.compare_exchange_strong(currentFd, newFd, std::memory_order_seq_cst)) {
+        close(newFd);
+        return currentFd;
+    }
+    // Raised before notify() could see the fd. Both sides are seq_cst, so
+    // at least one of them writes it.
+    if (isRaised.load(std::memory_order_seq_cst)) {
+        const std::uint64_t value{1};
+        (void) write(newFd, &value, sizeof(value));
+    }
+    return newFd;
+}
+
+void UpkeepSignal::notify() {
+    waiters.notifyAll();
+    const int currentFd{fd.load(std::memory_order_seq_cst)};
+    if (currentFd >= 0) {
+        const std::uint64_t value{1};
+        (void) write(currentFd, &value, sizeof(value));
+    }
+}
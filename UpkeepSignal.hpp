@@ -0,0 +1,51 @@
+//
+// Tells the upkeep thread of a cache that upkeep() is needed.
+//
+// raise() is called on the acquire path when the free blocks run low. It
+// only loads a flag while the signal is already raised, so the user threads
+// pay a system call only once per episode. The upkeep side either sleeps in
+// waitFor() or polls getFd() (an eventfd) in its own epoll loop, so upkeep()
+// runs when the free blocks run low and not in a hot loop.
+//
+
+#ifndef UPKEEP_SIGNAL_HPP
+#define UPKEEP_SIGNAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include "WaitQueue.hpp"
+
+class UpkeepSignal {
+public:
+    UpkeepSignal() = default;
+
+    UpkeepSignal(const UpkeepSignal &) = delete;
+
+    virtual ~UpkeepSignal();
+
+    void raise();
+
+    // Returns true if the signal was raised, and clears it.
+    // Returns false on timeout. A timeout of 0 only checks the signal.
+    bool waitFor(std::chrono::nanoseconds timeout);
+
+    // An eventfd that is readable while the signal is raised. Made on the
+    // first call and closed with the signal. After it became readable call
+    // waitFor(0), which clears it. It may be readable spuriously.
+    int getFd();
+
+private:
+    alignas(cacheLineSize) std::atomic<bool> isRaised{false};
+    std::atomic<int> fd{-1};
+    WaitQueue waiters{};
+
+    void notify();
+};
+
+inline void UpkeepSignal::raise() {
+    if (!isRaised.load(std::memory_order_relaxed) && !isRaised.exchange(true, std::memory_order_seq_cst)) {
+        notify();
+    }
+}
+
+#endif
@@ -0,0 +1,25 @@
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "WaitQueue.hpp"
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "The futex word must be a plain 32 bit word");
+
+void WaitQueue::Waiter::wait(std::uint32_t ticket, std::chrono::nanoseconds timeout) {
+    if (timeout <= std::chrono::nanoseconds::zero()) {
+        return;
+    }
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec relativeTimeout{};
+    relativeTimeout.tv_sec = static_cast<time_t>(seconds.count());
+    relativeTimeout.tv_nsec = static_cast<long>((timeout - seconds).count());
+    // Returns at once if the sequence has changed since ticket was read.
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&queue.sequence), FUTEX_WAIT_PRIVATE, ticket,
+            &relativeTimeout, nullptr, 0);
+}
+
+void WaitQueue::notify(int count) {
+    sequence.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sequence), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
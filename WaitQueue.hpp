@@ -0,0 +1,99 @@
+//
+// Lets threads sleep until another thread notifies them, or a timeout.
+//
+// Built on a futex: a waiter sleeps in the kernel as long as the sequence
+// word still has the value it read, and notifying bumps the word before
+// waking. A notification between reading the ticket and falling asleep
+// is therefore never lost, the wait just returns at once.
+//
+// notifyOne() and notifyAll() only load the waiter count when nobody is
+// waiting, no system call and no store. So they can sit on the fast path
+// of release().
+//
+// The caller checks its condition (e.g. an empty free list) between
+// getTicket() and wait(). The notifying thread must make the condition
+// change visible before it notifies, and the check of the waiter must be
+// ordered after Waiter registered, e.g. by seq_cst atomics or by a mutex
+// that both sides take.
+//
+
+#ifndef WAIT_QUEUE_HPP
+#define WAIT_QUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include "BlockLayout.hpp"
+
+class WaitQueue {
+public:
+    // Counts as a waiter of the queue while it exists.
+    class Waiter {
+    public:
+        explicit Waiter(WaitQueue & queue);
+
+        Waiter(const Waiter &) = delete;
+
+        ~Waiter();
+
+        // Read it before checking the condition and pass it to wait().
+        std::uint32_t getTicket();
+
+        // Sleeps until a notification after getTicket() returned ticket or
+        // until timeout. It may also return early, so check the condition again.
+        void wait(std::uint32_t ticket, std::chrono::nanoseconds timeout);
+
+    private:
+        WaitQueue & queue;
+    };
+
+    WaitQueue() = default;
+
+    WaitQueue(const WaitQueue &) = delete;
+
+    virtual ~WaitQueue() = default;
+
+    bool hasWaiters();
+
+    void notifyOne();
+
+    void notifyAll();
+
+private:
+    // Both are only written when there are waiters.
+    alignas(cacheLineSize) std::atomic<std::uint32_t> waiterCount{0};
+    std::atomic<std::uint32_t> sequence{0};
+
+    void notify(int count);
+};
+
+inline WaitQueue::Waiter::Waiter(WaitQueue & queue) : queue{queue} {
+    queue.waiterCount.fetch_add(1, std::memory_order_seq_cst);
+}
+
+inline WaitQueue::Waiter::~Waiter() {
+    queue.waiterCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline std::uint32_t WaitQueue::Waiter::getTicket() {
+    return queue.sequence.load(std::memory_order_acquire);
+}
+
+inline bool WaitQueue::hasWaiters() {
+    return waiterCount.load(std::memory_order_seq_cst) != 0;
+}
+
+inline void WaitQueue::notifyOne() {
+    if (hasWaiters()) {
+        notify(1);
+    }
+}
+
+inline void WaitQueue::notifyAll() {
+    if (hasWaiters()) {
+        notify(std::numeric_limits<int>::max());
+    }
+}
+
+#endif
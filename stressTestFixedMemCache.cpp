@@ -0,0 +1,120 @@
+#include <thread>
+#include <iostream>
+#include <random>
+#include <chrono>
+
+#include "catch.hpp"
+
+#include "FixedMemCache.hpp"
+#include "LockFreeLinkedMemCache.hpp"
+#include "PlainOldData.hpp"
+#include "StressTestHelper.hpp"
+
+#define TEST_NAME "FixedMemCache: Parallel stress test. Random acquire/release. Verify data"
+TEST_CASE(TEST_NAME, "[FixedMemCache]") {
+    const std::size_t minFreeBlocksCount{100};
+    FixedMemCache<sizeof(PlainOldData)> memCache{minFreeBlocksCount};
+    using Block = FixedMemCache<sizeof(PlainOldData)>::Block;
+
+    std::atomic<bool> isTestOver{false};
+    std::size_t acquireCount{0};
+    std::size_t failedAcquireCount{0};
+
+    std::thread upkeeperThread{ [&] {
+        while (!isTestOver.load()) {
+            memCache.upkeep();
+
+            // Simulate some work/delay
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    } };
+
+    std::thread userThread{ [&] {
+        const int maxRandomNumber{1000};
+        std::mt19937 mt{1729};
+        std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
+
+        const int maxAcquiredBlockCount{100000};
+
+        std::vector<PooledBlock<Block>> acquiredBlocks{};
+        acquiredBlocks.reserve(maxAcquiredBlockCount);
+
+        std::vector<int> verificationDatas{};
+        verificationDatas.reserve(maxAcquiredBlockCount);
+
+        while (!isTestOver.load()) {
+            const int randomNumber{randomNumberGenerator(mt)};
+            const bool shouldAcquire{randomNumber < (maxRandomNumber / 2)};
+            if (shouldAcquire) {
+                if (acquiredBlocks.size() < maxAcquiredBlockCount) {
+                    ++acquireCount;
+                    PooledBlock<Block> block{memCache.acquire()};
+                    if (block != nullptr) {
+                        block->getAs<PlainOldData>()->set(randomNumber);
+                        acquiredBlocks.push_back(std::move(block));
+                        verificationDatas.push_back(randomNumber);
+                    } else {
+                        ++failedAcquireCount;
+                    }
+                }
+            } else {
+                if (!acquiredBlocks.empty()) {
+                    PooledBlock<Block> block{std::move(acquiredBlocks.back())};
+                    acquiredBlocks.pop_back();
+                    verificationDatas.pop_back();
+                    memCache.release(std::move(block));
+                }
+            }
+            for (std::size_t i{0}; i < acquiredBlocks.size(); ++i) {
+                const PooledBlock<Block> & block = acquiredBlocks[i];
+                int verificationData = verificationDatas[i];
+                REQUIRE(block->getAs<PlainOldData>()->verify(verificationData));
+            }
+        }
+    } };
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    isTestOver.store(true);
+    upkeeperThread.join();
+    userThread.join();
+
+    printStressTestResult(TEST_NAME, acquireCount, failedAcquireCount, memCache.getAllocationCount());
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+}
+#undef TEST_NAME
+
+template<typename MemCacheT>
+static double measureAcquireReleaseNanoseconds(MemCacheT & memCache, std::size_t iterationCount) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i{0}; i < iterationCount; ++i) {
+        auto block = memCache.acquire();
+        block->template getAs<PlainOldData>()->set(static_cast<int>(i));
+        memCache.release(std::move(block));
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterationCount;
+}
+
+#define TEST_NAME "FixedMemCache: Benchmark acquire/release against LockFreeLinkedMemCache"
+TEST_CASE(TEST_NAME, "[FixedMemCache]") {
+    const std::size_t iterationCount{20000000};
+
+    FixedMemCache<sizeof(PlainOldData), 64> fixedMemCache{100};
+    fixedMemCache.upkeep();
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData), 64};
+    memCache.upkeep();
+
+    double fixedNanoseconds{measureAcquireReleaseNanoseconds(fixedMemCache, iterationCount)};
+    double nanoseconds{measureAcquireReleaseNanoseconds(memCache, iterationCount)};
+
+    printBenchmarkResult(TEST_NAME, {
+            {"FixedMemCache<" + std::to_string(sizeof(PlainOldData)) + ", 64>", fixedNanoseconds},
+            {"LockFreeLinkedMemCache", nanoseconds}});
+
+    REQUIRE(fixedMemCache.getFreeBlocksCount() == 100);
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+#undef TEST_NAME
@@ -0,0 +1,45 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "MemCache.hpp"
+#include "LockFreeLinkedMemCache.hpp"
+#include "FlatCombiningMemCache.hpp"
+#include "PlainOldData.hpp"
+#include "StressTestHelper.hpp"
+
+#define TEST_NAME "FlatCombiningMemCache: Benchmark scaling against MemCache and LockFreeLinkedMemCache"
+TEST_CASE(TEST_NAME, "[FlatCombiningMemCache]") {
+    const std::size_t totalIterationCount{2000000};
+
+    for (int threadCount : {1, 2, 4, 8, 16, 32, 64}) {
+        const std::size_t iterationCount{totalIterationCount / threadCount};
+
+        MemCache memCache{1000, sizeof(PlainOldData)};
+        memCache.upkeep();
+        LockFreeLinkedMemCache lockFreeMemCache{1000, sizeof(PlainOldData)};
+        lockFreeMemCache.upkeep();
+        FlatCombiningMemCache flatCombiningMemCache{1000, sizeof(PlainOldData)};
+        flatCombiningMemCache.upkeep();
+
+        double nanoseconds{measureThroughputNanoseconds(memCache, threadCount, iterationCount)};
+        double lockFreeNanoseconds{measureThroughputNanoseconds(lockFreeMemCache, threadCount, iterationCount)};
+        double flatCombiningNanoseconds{measureThroughputNanoseconds(flatCombiningMemCache, threadCount, iterationCount)};
+
+        printBenchmarkResult(TEST_NAME " (" + std::to_string(threadCount) + " threads)", {
+                {"MemCache", nanoseconds},
+                {"LockFreeLinkedMemCache", lockFreeNanoseconds},
+                {"FlatCombiningMemCache", flatCombiningNanoseconds}});
+        std::cout << "\trequests per combining pass = "
+                  << (static_cast<double>(flatCombiningMemCache.getCombinedRequestCount())
+                      / flatCombiningMemCache.getCombineCount()) << std::endl << std::endl;
+
+        REQUIRE(memCache.getFreeBlocksCount() == 1000);
+        REQUIRE(lockFreeMemCache.getFreeBlocksCount() == 1000);
+        REQUIRE(flatCombiningMemCache.getFreeBlocksCount() == 1000);
+    }
+}
+#undef TEST_NAME
@@ -1,6 +1,11 @@
+#include <chrono>
 #include <thread>
+#include <vector>
 #include <iostream>
 #include <random>
+#include <atomic>
+#include <cmath>
+#include <string>
 
 #include "catch.hpp"
 
@@ -26,7 +31,7 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
     std::thread userThread{ [&] {
         while (!isTestOver.load()) {
             ++acquireCount;
-            std::unique_ptr<LinkedMemBlock> block{memCache.acquire()};
+            PooledBlock<LinkedMemBlock> block{memCache.acquire()};
             if (block != nullptr) {
                 memCache.release(std::move(block));
             } else {
@@ -43,6 +48,9 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
 
     printStressTestResult(TEST_NAME, acquireCount, failedAcquireCount, memCache.getAllocationCount());
 
+    // The user thread holds at most one block, so only upkeep() could make acquire() fail.
+    REQUIRE(failedAcquireCount == 0);
+
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
 }
@@ -72,7 +80,7 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
         std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
 
         const int maxAcquiredBlockCount{100000};
-        std::vector<std::unique_ptr<LinkedMemBlock>> acquiredBlocks{};
+        std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
         acquiredBlocks.reserve(maxAcquiredBlockCount);
 
         while (!isTestOver.load()) {
@@ -81,7 +89,7 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
             if (shouldAcquire) {
                 if (acquiredBlocks.size() < maxAcquiredBlockCount) {
                     ++acquireCount;
-                    std::unique_ptr<LinkedMemBlock> block{memCache.acquire()};
+                    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
                     if (block != nullptr) {
                         acquiredBlocks.push_back(std::move(block));
                     } else {
@@ -90,7 +98,7 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
                 }
             } else {
                 if (!acquiredBlocks.empty()) {
-                    std::unique_ptr<LinkedMemBlock> block{std::move(acquiredBlocks.back())};
+                    PooledBlock<LinkedMemBlock> block{std::move(acquiredBlocks.back())};
                     acquiredBlocks.pop_back();
                     memCache.release(std::move(block));
                 }
@@ -136,7 +144,7 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
 
         const int maxAcquiredBlockCount{100000};
 
-        std::vector<std::unique_ptr<LinkedMemBlock>> acquiredBlocks{};
+        std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
         acquiredBlocks.reserve(maxAcquiredBlockCount);
 
         std::vector<int> verificationDatas{};
@@ -148,7 +156,7 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
             if (shouldAcquire) {
                 if (acquiredBlocks.size() < maxAcquiredBlockCount) {
                     ++acquireCount;
-                    std::unique_ptr<LinkedMemBlock> block{memCache.acquire()};
+                    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
                     if (block != nullptr) {
                         block->getAs<PlainOldData>()->set(randomNumber);
                         acquiredBlocks.push_back(std::move(block));
@@ -159,14 +167,14 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
                 }
             } else {
                 if (!acquiredBlocks.empty()) {
-                    std::unique_ptr<LinkedMemBlock> block{std::move(acquiredBlocks.back())};
+                    PooledBlock<LinkedMemBlock> block{std::move(acquiredBlocks.back())};
                     acquiredBlocks.pop_back();
                     verificationDatas.pop_back();
                     memCache.release(std::move(block));
                 }
             }
             for (std::size_t i{0}; i < acquiredBlocks.size(); ++i) {
-                const std::unique_ptr<LinkedMemBlock> & block = acquiredBlocks[i];
+                const PooledBlock<LinkedMemBlock> & block = acquiredBlocks[i];
                 int verificationData = verificationDatas[i];
                 REQUIRE(block->getAs<PlainOldData>()->verify(verificationData));
             }
@@ -185,3 +193,294 @@ TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
     REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
 }
 #undef TEST_NAME
+
+#define TEST_NAME  "LockFreeLinkedMemCache: Parallel stress test. Multiple user threads. Verify data"
+TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
+    const std::size_t minFreeBlocksCount{100};
+    LockFreeLinkedMemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+
+    const int userThreadCount{4};
+    std::atomic<bool> isTestOver{false};
+    std::atomic<std::size_t> acquireCount{0};
+    std::atomic<std::size_t> failedAcquireCount{0};
+    std::atomic<std::size_t> corruptBlockCount{0};
+
+    std::thread upkeeperThread{ [&] {
+        while (!isTestOver.load()) {
+            memCache.upkeep();
+
+            // Simulate some work/delay
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    } };
+
+    // Every user thread writes values no other thread writes. A block handed
+    // out to two threads at once (e.g. because of ABA) shows up as corrupt data.
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < userThreadCount; ++threadIndex) {
+        userThreads.emplace_back([&, threadIndex] {
+            const int maxRandomNumber{1000};
+            std::mt19937 mt{static_cast<std::mt19937::result_type>(1729 + threadIndex)};
+            std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
+
+            const std::size_t maxAcquiredBlockCount{1000};
+
+            std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+            acquiredBlocks.reserve(maxAcquiredBlockCount);
+
+            std::vector<int> verificationDatas{};
+            verificationDatas.reserve(maxAcquiredBlockCount);
+
+            std::size_t localAcquireCount{0};
+            std::size_t localFailedAcquireCount{0};
+            std::size_t localCorruptBlockCount{0};
+
+            while (!isTestOver.load()) {
+                const int randomNumber{randomNumberGenerator(mt)};
+                const bool shouldAcquire{randomNumber < (maxRandomNumber / 2)};
+                if (shouldAcquire) {
+                    if (acquiredBlocks.size() < maxAcquiredBlockCount) {
+                        ++localAcquireCount;
+                        PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+                        if (block != nullptr) {
+                            const int verificationData{threadIndex * maxRandomNumber + randomNumber};
+                            block->getAs<PlainOldData>()->set(verificationData);
+                            acquiredBlocks.push_back(std::move(block));
+                            verificationDatas.push_back(verificationData);
+                        } else {
+                            ++localFailedAcquireCount;
+                        }
+                    }
+                } else {
+                    if (!acquiredBlocks.empty()) {
+                        PooledBlock<LinkedMemBlock> block{std::move(acquiredBlocks.back())};
+                        acquiredBlocks.pop_back();
+                        verificationDatas.pop_back();
+                        memCache.release(std::move(block));
+                    }
+                }
+                for (std::size_t i{0}; i < acquiredBlocks.size(); ++i) {
+                    if (!acquiredBlocks[i]->getAs<PlainOldData>()->verify(verificationDatas[i])) {
+                        ++localCorruptBlockCount;
+                    }
+                }
+            }
+
+            acquireCount += localAcquireCount;
+            failedAcquireCount += localFailedAcquireCount;
+            corruptBlockCount += localCorruptBlockCount;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    isTestOver.store(true);
+    upkeeperThread.join();
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    printStressTestResult(TEST_NAME, acquireCount.load(), failedAcquireCount.load(), memCache.getAllocationCount());
+
+    REQUIRE(corruptBlockCount.load() == 0);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+}
+#undef TEST_NAME
+
+#define TEST_NAME  "LockFreeLinkedMemCache: Parallel stress test. Every block is accounted for after millions of upkeeps"
+TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
+    const std::size_t minFreeBlocksCount{16};
+    const std::size_t upkeepCount{2000000};
+    LockFreeLinkedMemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+
+    const int userThreadCount{2};
+    std::atomic<bool> isTestOver{false};
+    std::atomic<std::size_t> acquireCount{0};
+    std::atomic<std::size_t> failedAcquireCount{0};
+    std::atomic<std::size_t> outstandingBlocksCount{0};
+
+    // The user threads release while upkeep() grows and shrinks, and keep
+    // some blocks when they stop, so the final count has all three kinds.
+    std::vector<std::vector<PooledBlock<LinkedMemBlock>>> acquiredBlocksOfThreads(userThreadCount);
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < userThreadCount; ++threadIndex) {
+        userThreads.emplace_back([&, threadIndex] {
+            std::mt19937 mt{static_cast<std::mt19937::result_type>(1729 + threadIndex)};
+            std::uniform_int_distribution<std::size_t> heldBlocksCountGenerator{0, 2 * minFreeBlocksCount};
+            std::vector<PooledBlock<LinkedMemBlock>> & acquiredBlocks{acquiredBlocksOfThreads[threadIndex]};
+
+            std::size_t localAcquireCount{0};
+            std::size_t localFailedAcquireCount{0};
+            while (!isTestOver.load()) {
+                const std::size_t heldBlocksCount{heldBlocksCountGenerator(mt)};
+                while (acquiredBlocks.size() < heldBlocksCount) {
+                    ++localAcquireCount;
+                    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+                    if (block == nullptr) {
+                        ++localFailedAcquireCount;
+                        break;
+                    }
+                    acquiredBlocks.push_back(std::move(block));
+                }
+                while (acquiredBlocks.size() > heldBlocksCount) {
+                    memCache.release(std::move(acquiredBlocks.back()));
+                    acquiredBlocks.pop_back();
+                }
+            }
+
+            acquireCount += localAcquireCount;
+            failedAcquireCount += localFailedAcquireCount;
+            outstandingBlocksCount += acquiredBlocks.size();
+        });
+    }
+
+    for (std::size_t i{0}; i < upkeepCount; ++i) {
+        memCache.upkeep();
+    }
+
+    isTestOver.store(true);
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    printStressTestResult(TEST_NAME, acquireCount.load(), failedAcquireCount.load(), memCache.getAllocationCount());
+
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount()
+            == memCache.getFreeBlocksCount() + memCache.getRetiredBlocksCount() + outstandingBlocksCount.load());
+
+    acquiredBlocksOfThreads.clear();
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+    REQUIRE(memCache.getAllocatedBlocksCount() == minFreeBlocksCount);
+}
+#undef TEST_NAME
+
+#define TEST_NAME "LockFreeLinkedMemCache: Benchmark. Contended acquire/release"
+TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
+    const std::size_t minFreeBlocksCount{64};
+    const int operationCount{1000000};
+
+    for (int userThreadCount : {1, 2, 4, 8}) {
+        LockFreeLinkedMemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+        memCache.upkeep();
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> userThreads{};
+        for (int threadIndex{0}; threadIndex < userThreadCount; ++threadIndex) {
+            userThreads.emplace_back([&memCache, operationCount] {
+                for (int i{0}; i < operationCount; ++i) {
+                    memCache.release(memCache.acquire());
+                }
+            });
+        }
+        for (std::thread & userThread : userThreads) {
+            userThread.join();
+        }
+        const std::chrono::duration<double, std::nano> elapsed{std::chrono::steady_clock::now() - start};
+        const double totalOperationCount{2.0 * operationCount * userThreadCount};
+
+        std::cout << TEST_NAME " (" << userThreadCount << " threads)" << std::endl
+                  << "\tacquire/release = " << elapsed.count() / totalOperationCount << " ns/op" << std::endl
+                  << "\tCAS retries = " << memCache.getCasRetryCount() << std::endl
+                  << "\teliminations = " << memCache.getEliminationCount() << std::endl
+                  << std::endl;
+
+        REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+    }
+}
+#undef TEST_NAME
+
+#define TEST_NAME "LockFreeLinkedMemCache: Benchmark. Uncontended acquire/release and acquireFor/release"
+TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
+    const std::size_t iterationCount{20000000};
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    // There are always free blocks, so acquireFor() must cost what acquire() does.
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i{0}; i < iterationCount; ++i) {
+        PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+        block->getAs<PlainOldData>()->set(static_cast<int>(i));
+        memCache.release(std::move(block));
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (std::size_t i{0}; i < iterationCount; ++i) {
+        PooledBlock<LinkedMemBlock> block{memCache.acquireFor(std::chrono::seconds(1))};
+        block->getAs<PlainOldData>()->set(static_cast<int>(i));
+        memCache.release(std::move(block));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printBenchmarkResult(TEST_NAME, {
+            {"acquire/release", std::chrono::duration<double, std::nano>(middle - start).count() / iterationCount},
+            {"acquireFor/release", std::chrono::duration<double, std::nano>(end - middle).count() / iterationCount}});
+
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+#undef TEST_NAME
+
+#define TEST_NAME "LockFreeLinkedMemCache: Allocations under sinusoidal load. Exact target against hysteresis"
+TEST_CASE(TEST_NAME, "[LockFreeLinkedMemCache]") {
+    const std::size_t minFreeBlocksCount{1000};
+    const std::size_t amplitude{10000};
+
+    auto run = [&](const std::string & variant, std::size_t highWatermark, double maxShrinkFraction) {
+        LockFreeLinkedMemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+        memCache.setHighWatermark(highWatermark);
+        memCache.setMaxShrinkFraction(maxShrinkFraction);
+        memCache.upkeep();
+
+        std::atomic<bool> isTestOver{false};
+        std::size_t acquireCount{0};
+        std::size_t failedAcquireCount{0};
+
+        std::thread upkeeperThread{ [&] {
+            while (!isTestOver.load()) {
+                memCache.upkeep();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        } };
+
+        // The acquired blocks follow a sine wave between 0 and 2 * amplitude
+        // with a period of 100 ms, so upkeep() sees every phase of it.
+        std::thread userThread{ [&] {
+            std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+            acquiredBlocks.reserve(2 * amplitude);
+            const auto start = std::chrono::steady_clock::now();
+            while (!isTestOver.load()) {
+                const double phase{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                                   * 2.0 * 3.14159265 / 0.1};
+                const auto acquiredBlockCount = static_cast<std::size_t>(amplitude * (1.0 + std::sin(phase)));
+                while (acquiredBlocks.size() > acquiredBlockCount) {
+                    acquiredBlocks.pop_back();
+                }
+                while (acquiredBlocks.size() < acquiredBlockCount) {
+                    ++acquireCount;
+                    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+                    if (block == nullptr) {
+                        ++failedAcquireCount;
+                        break;
+                    }
+                    acquiredBlocks.push_back(std::move(block));
+                }
+                std::this_thread::yield();
+            }
+        } };
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+
+        isTestOver.store(true);
+        upkeeperThread.join();
+        userThread.join();
+
+        printStressTestResult(TEST_NAME " (" + variant + ")", acquireCount, failedAcquireCount,
+                              memCache.getAllocationCount());
+    };
+
+    run("exact target", minFreeBlocksCount, 1.0);
+    run("high watermark 3 * amplitude, maxShrinkFraction 0.1", 3 * amplitude, 0.1);
+}
+#undef TEST_NAME
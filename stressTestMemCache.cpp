@@ -1,7 +1,11 @@
+#include <chrono>
 #include <thread>
 #include <iostream>
 #include <random>
 #include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
 
 #include "catch.hpp"
 
@@ -27,7 +31,7 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
     std::thread userThread{ [&] {
         while (!isTestOver.load()) {
             ++acquireCount;
-            std::unique_ptr<MemBlock> block{memCache.acquire()};
+            PooledBlock<MemBlock> block{memCache.acquire()};
             if (block != nullptr) {
                 memCache.release(std::move(block));
             } else {
@@ -73,7 +77,7 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
         std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
 
         const int maxAcquiredBlockCount{100000};
-        std::vector<std::unique_ptr<MemBlock>> acquiredBlocks{};
+        std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
         acquiredBlocks.reserve(maxAcquiredBlockCount);
 
         while (!isTestOver.load()) {
@@ -81,7 +85,7 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
             if (randomNumber < (maxRandomNumber / 2)) {
                 if (acquiredBlocks.size() < maxAcquiredBlockCount) {
                     ++acquireCount;
-                    std::unique_ptr<MemBlock> block{memCache.acquire()};
+                    PooledBlock<MemBlock> block{memCache.acquire()};
                     if (block != nullptr) {
                         acquiredBlocks.push_back(std::move(block));
                     } else {
@@ -90,7 +94,7 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
                 }
             } else {
                 if (!acquiredBlocks.empty()) {
-                    std::unique_ptr<MemBlock> block{std::move(acquiredBlocks.back())};
+                    PooledBlock<MemBlock> block{std::move(acquiredBlocks.back())};
                     acquiredBlocks.pop_back();
                     memCache.release(std::move(block));
                 }
@@ -136,7 +140,7 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
 
         const int maxAcquiredBlockCount{100000};
 
-        std::vector<std::unique_ptr<MemBlock>> acquiredBlocks{};
+        std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
         acquiredBlocks.reserve(maxAcquiredBlockCount);
 
         std::vector<int> verificationDatas{};
@@ -147,7 +151,7 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
             if (randomNumber < (maxRandomNumber / 2)) {
                 if (acquiredBlocks.size() < maxAcquiredBlockCount) {
                     ++acquireCount;
-                    std::unique_ptr<MemBlock> block{memCache.acquire()};
+                    PooledBlock<MemBlock> block{memCache.acquire()};
                     if (block != nullptr) {
                         block->getAs<PlainOldData>()->set(randomNumber);
                         acquiredBlocks.push_back(std::move(block));
@@ -158,14 +162,14 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
                 }
             } else {
                 if (!acquiredBlocks.empty()) {
-                    std::unique_ptr<MemBlock> block{std::move(acquiredBlocks.back())};
+                    PooledBlock<MemBlock> block{std::move(acquiredBlocks.back())};
                     acquiredBlocks.pop_back();
                     verificationDatas.pop_back();
                     memCache.release(std::move(block));
                 }
             }
             for (std::size_t i{0}; i < acquiredBlocks.size(); ++i) {
-                const std::unique_ptr<MemBlock> & block{acquiredBlocks[i]};
+                const PooledBlock<MemBlock> & block{acquiredBlocks[i]};
                 int verificationData{verificationDatas[i]};
                 REQUIRE(block->getAs<PlainOldData>()->verify(verificationData));
             }
@@ -184,3 +188,214 @@ TEST_CASE(TEST_NAME, "[MemCache]") {
     REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
 }
 #undef TEST_NAME
+
+#define TEST_NAME "MemCache: Acquire latency while upkeep grows and shrinks"
+TEST_CASE(TEST_NAME, "[MemCache]") {
+    const std::size_t minFreeBlocksCount{20000};
+
+    auto run = [&](const std::string & variant, bool isUpkeeping) {
+        MemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+        memCache.upkeep();
+
+        std::atomic<bool> isTestOver{false};
+
+        std::thread upkeeperThread{ [&] {
+            while (isUpkeeping && !isTestOver.load()) {
+                memCache.upkeep();
+            }
+        } };
+
+        // The user thread takes minFreeBlocksCount blocks and gives them back,
+        // so every other upkeep() grows or shrinks by minFreeBlocksCount blocks.
+        LatencySample latencies{1000000};
+        std::thread userThread{ [&] {
+            std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+            acquiredBlocks.reserve(minFreeBlocksCount);
+            while (!isTestOver.load()) {
+                for (std::size_t i{0}; i < minFreeBlocksCount; ++i) {
+                    auto start = std::chrono::steady_clock::now();
+                    PooledBlock<MemBlock> block{memCache.acquire()};
+                    auto end = std::chrono::steady_clock::now();
+                    latencies.add(std::chrono::duration<double, std::nano>(end - start).count());
+                    if (block != nullptr) {
+                        acquiredBlocks.push_back(std::move(block));
+                    }
+                }
+                acquiredBlocks.clear();
+            }
+        } };
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+
+        isTestOver.store(true);
+        upkeeperThread.join();
+        userThread.join();
+
+        latencies.print(TEST_NAME " (" + variant + ")");
+
+        memCache.upkeep();
+        REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+    };
+
+    run("no upkeep running", false);
+    run("upkeep running", true);
+}
+#undef TEST_NAME
+
+#define TEST_NAME "MemCache: Benchmark. Uncontended acquire/release and acquireFor/release"
+TEST_CASE(TEST_NAME, "[MemCache]") {
+    const std::size_t iterationCount{20000000};
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    // There are always free blocks, so acquireFor() must cost what acquire() does.
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i{0}; i < iterationCount; ++i) {
+        PooledBlock<MemBlock> block{memCache.acquire()};
+        block->getAs<PlainOldData>()->set(static_cast<int>(i));
+        memCache.release(std::move(block));
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (std::size_t i{0}; i < iterationCount; ++i) {
+        PooledBlock<MemBlock> block{memCache.acquireFor(std::chrono::seconds(1))};
+        block->getAs<PlainOldData>()->set(static_cast<int>(i));
+        memCache.release(std::move(block));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printBenchmarkResult(TEST_NAME, {
+            {"acquire/release", std::chrono::duration<double, std::nano>(middle - start).count() / iterationCount},
+            {"acquireFor/release", std::chrono::duration<double, std::nano>(end - middle).count() / iterationCount}});
+
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+#undef TEST_NAME
+
+#define TEST_NAME "MemCache: Parallel stress test. Random acquire/release. Upkeep when needed"
+TEST_CASE(TEST_NAME, "[MemCache]") {
+    const std::size_t minFreeBlocksCount{100};
+    MemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    std::atomic<bool> isTestOver{false};
+    std::size_t acquireCount{0};
+    std::size_t failedAcquireCount{0};
+    std::size_t upkeepCount{0};
+
+    // Sleeps instead of polling. Runs upkeep() only when acquire() signals it.
+    std::thread upkeeperThread{ [&] {
+        while (!isTestOver.load()) {
+            if (memCache.waitForUpkeepNeeded(std::chrono::milliseconds(100))) {
+                memCache.upkeep();
+                ++upkeepCount;
+            }
+        }
+    } };
+
+    std::thread userThread{ [&] {
+        const int maxRandomNumber{1000};
+        std::mt19937 mt{1729};
+        std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
+
+        const int maxAcquiredBlockCount{1000};
+        std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+        acquiredBlocks.reserve(maxAcquiredBlockCount);
+
+        while (!isTestOver.load()) {
+            const int randomNumber{randomNumberGenerator(mt)};
+            if (randomNumber < (maxRandomNumber / 2)) {
+                if (acquiredBlocks.size() < maxAcquiredBlockCount) {
+                    ++acquireCount;
+                    PooledBlock<MemBlock> block{memCache.acquire()};
+                    if (block != nullptr) {
+                        acquiredBlocks.push_back(std::move(block));
+                    } else {
+                        ++failedAcquireCount;
+                    }
+                }
+            } else {
+                if (!acquiredBlocks.empty()) {
+                    PooledBlock<MemBlock> block{std::move(acquiredBlocks.back())};
+                    acquiredBlocks.pop_back();
+                    memCache.release(std::move(block));
+                }
+            }
+        }
+    } };
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    isTestOver.store(true);
+    upkeeperThread.join();
+    userThread.join();
+
+    printStressTestResult(TEST_NAME, acquireCount, failedAcquireCount, memCache.getAllocationCount());
+    std::cout << "\tupkeeps = " << upkeepCount << std::endl << std::endl;
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+}
+#undef TEST_NAME
+
+#define TEST_NAME "MemCache: Allocations under sinusoidal load. Exact target against hysteresis"
+TEST_CASE(TEST_NAME, "[MemCache]") {
+    const std::size_t minFreeBlocksCount{1000};
+    const std::size_t amplitude{10000};
+
+    auto run = [&](const std::string & variant, std::size_t highWatermark, double maxShrinkFraction) {
+        MemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+        memCache.setHighWatermark(highWatermark);
+        memCache.setMaxShrinkFraction(maxShrinkFraction);
+        memCache.upkeep();
+
+        std::atomic<bool> isTestOver{false};
+        std::size_t acquireCount{0};
+        std::size_t failedAcquireCount{0};
+
+        std::thread upkeeperThread{ [&] {
+            while (!isTestOver.load()) {
+                memCache.upkeep();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        } };
+
+        // The acquired blocks follow a sine wave between 0 and 2 * amplitude
+        // with a period of 100 ms, so upkeep() sees every phase of it.
+        std::thread userThread{ [&] {
+            std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+            acquiredBlocks.reserve(2 * amplitude);
+            const auto start = std::chrono::steady_clock::now();
+            while (!isTestOver.load()) {
+                const double phase{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                                   * 2.0 * 3.14159265 / 0.1};
+                const auto acquiredBlockCount = static_cast<std::size_t>(amplitude * (1.0 + std::sin(phase)));
+                while (acquiredBlocks.size() > acquiredBlockCount) {
+                    acquiredBlocks.pop_back();
+                }
+                while (acquiredBlocks.size() < acquiredBlockCount) {
+                    ++acquireCount;
+                    PooledBlock<MemBlock> block{memCache.acquire()};
+                    if (block == nullptr) {
+                        ++failedAcquireCount;
+                        break;
+                    }
+                    acquiredBlocks.push_back(std::move(block));
+                }
+                std::this_thread::yield();
+            }
+        } };
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+
+        isTestOver.store(true);
+        upkeeperThread.join();
+        userThread.join();
+
+        printStressTestResult(TEST_NAME " (" + variant + ")", acquireCount, failedAcquireCount,
+                              memCache.getAllocationCount());
+    };
+
+    run("exact target", minFreeBlocksCount, 1.0);
+    run("high watermark 3 * amplitude, maxShrinkFraction 0.1", 3 * amplitude, 0.1);
+}
+#undef TEST_NAME
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "LockFreeLinkedMemCache.hpp"
+#include "PerCpuLinkedMemCache.hpp"
+#include "PlainOldData.hpp"
+#include "StressTestHelper.hpp"
+
+#define TEST_NAME  "PerCpuLinkedMemCache: Parallel stress test. More user threads than CPUs. Verify data"
+TEST_CASE(TEST_NAME, "[PerCpuLinkedMemCache]") {
+    const std::size_t minFreeBlocksCount{1000};
+    PerCpuLinkedMemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    const unsigned userThreadCount{4 * getCpuCount()};
+    std::atomic<bool> isTestOver{false};
+    std::atomic<std::size_t> acquireCount{0};
+    std::atomic<std::size_t> failedAcquireCount{0};
+    std::atomic<std::size_t> corruptBlockCount{0};
+
+    std::thread upkeeperThread{ [&] {
+        while (!isTestOver.load()) {
+            memCache.upkeep();
+
+            // Simulate some work/delay
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    } };
+
+    std::vector<std::thread> userThreads{};
+    for (unsigned threadIndex{0}; threadIndex < userThreadCount; ++threadIndex) {
+        userThreads.emplace_back([&, threadIndex] {
+            const int maxRandomNumber{1000};
+            std::mt19937 mt{1729 + threadIndex};
+            std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
+
+            const std::size_t maxAcquiredBlockCount{100};
+
+            std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+            std::vector<int> verificationDatas{};
+
+            std::size_t localAcquireCount{0};
+            std::size_t localFailedAcquireCount{0};
+            std::size_t localCorruptBlockCount{0};
+
+            while (!isTestOver.load()) {
+                const int randomNumber{randomNumberGenerator(mt)};
+                const bool shouldAcquire{randomNumber < (maxRandomNumber / 2)};
+                if (shouldAcquire) {
+                    if (acquiredBlocks.size() < maxAcquiredBlockCount) {
+                        ++localAcquireCount;
+                        PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+                        if (block != nullptr) {
+                            const int verificationData{static_cast<int>(threadIndex) * maxRandomNumber + randomNumber};
+                            block->getAs<PlainOldData>()->set(verificationData);
+                            acquiredBlocks.push_back(std::move(block));
+                            verificationDatas.push_back(verificationData);
+                        } else {
+                            ++localFailedAcquireCount;
+                        }
+                    }
+                } else {
+                    if (!acquiredBlocks.empty()) {
+                        PooledBlock<LinkedMemBlock> block{std::move(acquiredBlocks.back())};
+                        acquiredBlocks.pop_back();
+                        verificationDatas.pop_back();
+                        memCache.release(std::move(block));
+                    }
+                }
+                for (std::size_t i{0}; i < acquiredBlocks.size(); ++i) {
+                    if (!acquiredBlocks[i]->getAs<PlainOldData>()->verify(verificationDatas[i])) {
+                        ++localCorruptBlockCount;
+                    }
+                }
+            }
+
+            acquireCount += localAcquireCount;
+            failedAcquireCount += localFailedAcquireCount;
+            corruptBlockCount += localCorruptBlockCount;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    isTestOver.store(true);
+    upkeeperThread.join();
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    printStressTestResult(TEST_NAME, acquireCount.load(), failedAcquireCount.load(), memCache.getAllocationCount());
+    std::cout << "\tCPU lists = " << memCache.getCpuListCount()
+              << ", rseq = " << (isRseqAvailable() ? "yes" : "no")
+              << ", steals = " << memCache.getStealCount() << std::endl
+              << std::endl;
+
+    REQUIRE(corruptBlockCount.load() == 0);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+}
+#undef TEST_NAME
+
+#define TEST_NAME "PerCpuLinkedMemCache: Benchmark against LockFreeLinkedMemCache"
+TEST_CASE(TEST_NAME, "[PerCpuLinkedMemCache]") {
+    const unsigned threadCount{2 * getCpuCount()};
+    const std::size_t iterationCount{2000000};
+
+    LockFreeLinkedMemCache memCache{1000, sizeof(PlainOldData)};
+    memCache.upkeep();
+    PerCpuLinkedMemCache perCpuMemCache{1000, sizeof(PlainOldData)};
+    perCpuMemCache.upkeep();
+
+    double nanoseconds{measureThroughputNanoseconds(memCache, threadCount, iterationCount)};
+    double perCpuNanoseconds{measureThroughputNanoseconds(perCpuMemCache, threadCount, iterationCount)};
+
+    printBenchmarkResult(TEST_NAME " (" + std::to_string(threadCount) + " threads)", {
+            {"LockFreeLinkedMemCache", nanoseconds},
+            {"PerCpuLinkedMemCache", perCpuNanoseconds}});
+
+    REQUIRE(memCache.getFreeBlocksCount() == 1000);
+    REQUIRE(perCpuMemCache.getFreeBlocksCount() == 1000);
+}
+#undef TEST_NAME
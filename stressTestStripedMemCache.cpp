@@ -0,0 +1,34 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "MemCache.hpp"
+#include "StripedMemCache.hpp"
+#include "PlainOldData.hpp"
+#include "StressTestHelper.hpp"
+
+#define TEST_NAME "StripedMemCache: Benchmark scaling against MemCache"
+TEST_CASE(TEST_NAME, "[StripedMemCache]") {
+    const std::size_t iterationCount{2000000};
+
+    for (int threadCount : {1, 2, 4, 8}) {
+        MemCache memCache{1000, sizeof(PlainOldData)};
+        memCache.upkeep();
+        StripedMemCache stripedMemCache{1000, sizeof(PlainOldData), 8};
+        stripedMemCache.upkeep();
+
+        double nanoseconds{measureThroughputNanoseconds(memCache, threadCount, iterationCount)};
+        double stripedNanoseconds{measureThroughputNanoseconds(stripedMemCache, threadCount, iterationCount)};
+
+        printBenchmarkResult(TEST_NAME " (" + std::to_string(threadCount) + " threads)", {
+                {"MemCache", nanoseconds},
+                {"StripedMemCache (8 shards)", stripedNanoseconds}});
+
+        REQUIRE(memCache.getFreeBlocksCount() == 1000);
+        REQUIRE(stripedMemCache.getFreeBlocksCount() == 1000);
+    }
+}
+#undef TEST_NAME
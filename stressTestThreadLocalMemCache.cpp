@@ -0,0 +1,161 @@
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <random>
+
+#include "catch.hpp"
+
+#include "LockFreeLinkedMemCache.hpp"
+#include "MemCache.hpp"
+#include "PlainOldData.hpp"
+#include "StressTestHelper.hpp"
+#include "ThreadLocalMemCache.hpp"
+
+#define TEST_NAME  "ThreadLocalMemCache: Parallel stress test. Multiple user threads. Verify data"
+TEST_CASE(TEST_NAME, "[ThreadLocalMemCache]") {
+    const std::size_t minFreeBlocksCount{1000};
+    MemCache memCache{minFreeBlocksCount, sizeof(PlainOldData)};
+    memCache.upkeep();
+    ThreadLocalMemCache<MemCache> threadLocalMemCache{memCache, 64};
+
+    const int userThreadCount{4};
+    std::atomic<bool> isTestOver{false};
+    std::atomic<std::size_t> failedAcquireCount{0};
+    std::atomic<std::size_t> corruptBlockCount{0};
+
+    std::thread upkeeperThread{ [&] {
+        while (!isTestOver.load()) {
+            memCache.upkeep();
+
+            // Simulate some work/delay
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    } };
+
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < userThreadCount; ++threadIndex) {
+        userThreads.emplace_back([&, threadIndex] {
+            const int maxRandomNumber{1000};
+            std::mt19937 mt{static_cast<std::mt19937::result_type>(1729 + threadIndex)};
+            std::uniform_int_distribution<int> randomNumberGenerator{1, maxRandomNumber};
+
+            const std::size_t maxAcquiredBlockCount{200};
+
+            std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+            std::vector<int> verificationDatas{};
+
+            std::size_t localFailedAcquireCount{0};
+            std::size_t localCorruptBlockCount{0};
+
+            while (!isTestOver.load()) {
+                const int randomNumber{randomNumberGenerator(mt)};
+                const bool shouldAcquire{randomNumber < (maxRandomNumber / 2)};
+                if (shouldAcquire) {
+                    if (acquiredBlocks.size() < maxAcquiredBlockCount) {
+                        PooledBlock<MemBlock> block{threadLocalMemCache.acquire()};
+                        if (block != nullptr) {
+                            const int verificationData{threadIndex * maxRandomNumber + randomNumber};
+                            block->getAs<PlainOldData>()->set(verificationData);
+                            acquiredBlocks.push_back(std::move(block));
+                            verificationDatas.push_back(verificationData);
+                        } else {
+                            ++localFailedAcquireCount;
+                        }
+                    }
+                } else {
+                    if (!acquiredBlocks.empty()) {
+                        PooledBlock<MemBlock> block{std::move(acquiredBlocks.back())};
+                        acquiredBlocks.pop_back();
+                        verificationDatas.pop_back();
+                        threadLocalMemCache.release(std::move(block));
+                    }
+                }
+                for (std::size_t i{0}; i < acquiredBlocks.size(); ++i) {
+                    if (!acquiredBlocks[i]->getAs<PlainOldData>()->verify(verificationDatas[i])) {
+                        ++localCorruptBlockCount;
+                    }
+                }
+            }
+
+            failedAcquireCount += localFailedAcquireCount;
+            corruptBlockCount += localCorruptBlockCount;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    isTestOver.store(true);
+    upkeeperThread.join();
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    ThreadLocalMemCacheStats stats{threadLocalMemCache.getStats()};
+    printStressTestResult(TEST_NAME, stats.acquireCount, failedAcquireCount.load(), memCache.getAllocationCount());
+    std::cout << "\tlocal hit rate = " << (stats.getLocalHitRate() * 100.0) << " %" << std::endl
+              << "\trefills = " << stats.refillCount << ", flushes = " << stats.flushCount << std::endl
+              << std::endl;
+
+    REQUIRE(corruptBlockCount.load() == 0);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == minFreeBlocksCount);
+}
+#undef TEST_NAME
+
+// Nanoseconds per acquire/release pair, with threadCount threads running it at once.
+template<typename MemCacheT>
+static double measureParallelAcquireReleaseNanoseconds(MemCacheT & memCache, int threadCount,
+                                                       std::size_t iterationCount) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < threadCount; ++threadIndex) {
+        userThreads.emplace_back([&memCache, iterationCount] {
+            for (std::size_t i{0}; i < iterationCount; ++i) {
+                auto block = memCache.acquire();
+                block->template getAs<PlainOldData>()->set(static_cast<int>(i));
+                memCache.release(std::move(block));
+            }
+        });
+    }
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterationCount;
+}
+
+#define TEST_NAME "ThreadLocalMemCache: Benchmark acquire/release against the shared caches"
+TEST_CASE(TEST_NAME, "[ThreadLocalMemCache]") {
+    const int threadCount{4};
+    const std::size_t iterationCount{5000000};
+
+    MemCache memCache{1000, sizeof(PlainOldData)};
+    memCache.upkeep();
+    LockFreeLinkedMemCache lockFreeMemCache{1000, sizeof(PlainOldData)};
+    lockFreeMemCache.upkeep();
+
+    double memCacheNanoseconds{measureParallelAcquireReleaseNanoseconds(memCache, threadCount, iterationCount)};
+    double lockFreeNanoseconds{measureParallelAcquireReleaseNanoseconds(lockFreeMemCache, threadCount,
+                                                                        iterationCount)};
+    double threadLocalNanoseconds;
+    double threadLocalLockFreeNanoseconds;
+    {
+        ThreadLocalMemCache<MemCache> threadLocalMemCache{memCache};
+        threadLocalNanoseconds = measureParallelAcquireReleaseNanoseconds(threadLocalMemCache, threadCount,
+                                                                          iterationCount);
+        ThreadLocalMemCache<LockFreeLinkedMemCache> threadLocalLockFreeMemCache{lockFreeMemCache};
+        threadLocalLockFreeNanoseconds = measureParallelAcquireReleaseNanoseconds(threadLocalLockFreeMemCache,
+                                                                                  threadCount, iterationCount);
+    }
+
+    printBenchmarkResult(TEST_NAME " (" + std::to_string(threadCount) + " threads)", {
+            {"MemCache", memCacheNanoseconds},
+            {"ThreadLocalMemCache<MemCache>", threadLocalNanoseconds},
+            {"LockFreeLinkedMemCache", lockFreeNanoseconds},
+            {"ThreadLocalMemCache<LockFreeLinkedMemCache>", threadLocalLockFreeNanoseconds}});
+
+    REQUIRE(memCache.getFreeBlocksCount() == 1000);
+    REQUIRE(lockFreeMemCache.getFreeBlocksCount() == 1000);
+}
+#undef TEST_NAME
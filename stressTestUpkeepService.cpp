@@ -0,0 +1,93 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "UpkeepService.hpp"
+#include "MemCache.hpp"
+#include "LockFreeLinkedMemCache.hpp"
+#include "PlainOldData.hpp"
+#include "StressTestHelper.hpp"
+
+#define TEST_NAME "UpkeepService: Parallel stress test. Many caches, random acquire/release"
+TEST_CASE(TEST_NAME, "[UpkeepService]") {
+    const std::size_t minFreeBlocksCount{100};
+    const int cacheCount{32};
+    const int userThreadCount{4};
+
+    // Half of the caches are locked, half are lock free. No hand-rolled upkeep threads.
+    std::vector<std::unique_ptr<MemCache>> memCaches{};
+    std::vector<std::unique_ptr<LockFreeLinkedMemCache>> lockFreeMemCaches{};
+    UpkeepService upkeepService{2};
+    for (int i{0}; i < cacheCount / 2; ++i) {
+        memCaches.push_back(std::make_unique<MemCache>(minFreeBlocksCount, sizeof(PlainOldData)));
+        upkeepService.add(*memCaches.back());
+        lockFreeMemCaches.push_back(std::make_unique<LockFreeLinkedMemCache>(minFreeBlocksCount, sizeof(PlainOldData)));
+        upkeepService.add(*lockFreeMemCaches.back());
+    }
+
+    std::atomic<bool> isTestOver{false};
+    std::atomic<std::size_t> acquireCount{0};
+    std::atomic<std::size_t> failedAcquireCount{0};
+
+    // Every user thread works on a few caches at a time, so their demand differs.
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < userThreadCount; ++threadIndex) {
+        userThreads.emplace_back([&, threadIndex] {
+            std::mt19937 mt{static_cast<std::mt19937::result_type>(1729 + threadIndex)};
+            std::uniform_int_distribution<int> cacheIndexGenerator{0, cacheCount / 2 - 1};
+            std::uniform_int_distribution<int> randomNumberGenerator{1, 1000};
+
+            std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+            std::vector<PooledBlock<LinkedMemBlock>> acquiredLinkedBlocks{};
+            std::size_t localAcquireCount{0};
+            std::size_t localFailedAcquireCount{0};
+            while (!isTestOver.load()) {
+                const int cacheIndex{cacheIndexGenerator(mt)};
+                const int blockCount{randomNumberGenerator(mt) % 200};
+                for (int i{0}; i < blockCount; ++i) {
+                    localAcquireCount += 2;
+                    PooledBlock<MemBlock> block{memCaches[cacheIndex]->acquire()};
+                    PooledBlock<LinkedMemBlock> linkedBlock{lockFreeMemCaches[cacheIndex]->acquire()};
+                    localFailedAcquireCount += (block == nullptr) + (linkedBlock == nullptr);
+                    acquiredBlocks.push_back(std::move(block));
+                    acquiredLinkedBlocks.push_back(std::move(linkedBlock));
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(randomNumberGenerator(mt)));
+                acquiredBlocks.clear();
+                acquiredLinkedBlocks.clear();
+            }
+            acquireCount += localAcquireCount;
+            failedAcquireCount += localFailedAcquireCount;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    isTestOver.store(true);
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    std::size_t allocationCount{0};
+    for (int i{0}; i < cacheCount / 2; ++i) {
+        allocationCount += memCaches[i]->getAllocationCount() + lockFreeMemCaches[i]->getAllocationCount();
+    }
+    printStressTestResult(TEST_NAME, acquireCount.load(), failedAcquireCount.load(), allocationCount);
+    std::cout << "\tupkeeps = " << upkeepService.getUpkeepCount() << std::endl << std::endl;
+
+    for (int i{0}; i < cacheCount / 2; ++i) {
+        REQUIRE(upkeepService.remove(*memCaches[i]));
+        REQUIRE(upkeepService.remove(*lockFreeMemCaches[i]));
+        memCaches[i]->upkeep();
+        lockFreeMemCaches[i]->upkeep();
+        REQUIRE(memCaches[i]->getFreeBlocksCount() == minFreeBlocksCount);
+        REQUIRE(lockFreeMemCaches[i]->getFreeBlocksCount() == minFreeBlocksCount);
+    }
+}
+#undef TEST_NAME
@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "FixedMemCache.hpp"
+#include "PlainOldData.hpp"
+
+TEST_CASE("FixedMemCache: Upkeep allocates minFreeBlocks", "[FixedMemCache]") {
+    FixedMemCache<sizeof(PlainOldData)> memCache{100};
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+
+TEST_CASE("FixedMemCache: Acquire from empty cache", "[FixedMemCache]") {
+    FixedMemCache<sizeof(PlainOldData)> memCache{100};
+    REQUIRE(memCache.acquire() == nullptr);
+}
+
+TEST_CASE("FixedMemCache: Acquire and release", "[FixedMemCache]") {
+    FixedMemCache<sizeof(PlainOldData)> memCache{3};
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    auto block = memCache.acquire();
+    REQUIRE(memCache.getFreeBlocksCount() == 2);
+
+    block->getAs<PlainOldData>()->set(42);
+    REQUIRE(block->getAs<PlainOldData>()->verify(42));
+
+    memCache.release(std::move(block));
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    memCache.release(nullptr);
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+}
+
+TEST_CASE("FixedMemCache: Upkeep releases unnecessary blocks", "[FixedMemCache]") {
+    FixedMemCache<sizeof(float)> memCache{3};
+
+    memCache.upkeep();
+    auto block = memCache.acquire();
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    memCache.release(std::move(block));
+    REQUIRE(memCache.getFreeBlocksCount() == 4);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+}
+
+TEST_CASE("FixedMemCache: Blocks are aligned to the template alignment", "[FixedMemCache]") {
+    FixedMemCache<sizeof(PlainOldData), 128> memCache{10};
+    memCache.upkeep();
+    REQUIRE(memCache.getAlignment() == 128);
+
+    std::vector<PooledBlock<FixedMemCache<sizeof(PlainOldData), 128>::Block>> blocks{};
+    for (auto block = memCache.acquire(); block != nullptr; block = memCache.acquire()) {
+        REQUIRE(reinterpret_cast<std::uintptr_t>(block->getAs<PlainOldData>()) % 128 == 0);
+        blocks.push_back(std::move(block));
+    }
+    REQUIRE(blocks.size() == 10);
+}
+
+TEST_CASE("FixedMemCache: Upkeep does not allocate more than MaxCapacity", "[FixedMemCache]") {
+    FixedMemCache<sizeof(PlainOldData), 64, 10> memCache{100};
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+    REQUIRE(memCache.getSlabCount() == 1);
+
+    auto block = memCache.acquire();
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 9);
+
+    memCache.release(std::move(block));
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+}
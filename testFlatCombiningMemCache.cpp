@@ -0,0 +1,99 @@
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "FlatCombiningMemCache.hpp"
+#include "PlainOldData.hpp"
+
+TEST_CASE("FlatCombiningMemCache: Upkeep allocates minFreeBlocks", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+    REQUIRE(memCache.getSlotCount() == 64);
+}
+
+TEST_CASE("FlatCombiningMemCache: Acquire from empty cache", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.acquire() == nullptr);
+}
+
+TEST_CASE("FlatCombiningMemCache: Acquire and release", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{4, sizeof(PlainOldData), 2};
+    memCache.upkeep();
+
+    PooledBlock<MemBlock> block{memCache.acquire()};
+    REQUIRE(block != nullptr);
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+    memCache.release(std::move(block));
+    REQUIRE(memCache.getFreeBlocksCount() == 4);
+
+    // Without other threads every request is combined on its own.
+    REQUIRE(memCache.getCombineCount() == 2);
+    REQUIRE(memCache.getCombinedRequestCount() == 2);
+}
+
+TEST_CASE("FlatCombiningMemCache: Dropped block goes back to the cache", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    {
+        PooledBlock<MemBlock> block{memCache.acquire()};
+        REQUIRE(memCache.getFreeBlocksCount() == 3);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 4);
+}
+
+TEST_CASE("FlatCombiningMemCache: Release a block of a different size", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{4, sizeof(PlainOldData)};
+    MemCache otherMemCache{1, 2 * sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+    REQUIRE(memCache.getCombinedRequestCount() == 0);
+}
+
+TEST_CASE("FlatCombiningMemCache: Release a block of another cache of the same size", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{0, sizeof(PlainOldData)};
+    MemCache otherMemCache{1, sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+    REQUIRE(memCache.getCombinedRequestCount() == 0);
+}
+
+TEST_CASE("FlatCombiningMemCache: More threads than slots acquire and release", "[FlatCombiningMemCache]") {
+    FlatCombiningMemCache memCache{16, sizeof(PlainOldData), 2};
+    memCache.upkeep();
+
+    std::vector<std::thread> userThreads{};
+    std::vector<std::size_t> corruptBlockCounts(8, 0);
+    for (int threadIndex{0}; threadIndex < 8; ++threadIndex) {
+        userThreads.emplace_back([&memCache, &corruptBlockCounts, threadIndex] {
+            for (int i{0}; i < 20000; ++i) {
+                PooledBlock<MemBlock> block{memCache.acquire()};
+                if (block != nullptr) {
+                    block->getAs<PlainOldData>()->set(threadIndex);
+                    std::this_thread::yield();
+                    if (!block->getAs<PlainOldData>()->verify(threadIndex)) {
+                        ++corruptBlockCounts[threadIndex];
+                    }
+                    memCache.release(std::move(block));
+                }
+            }
+        });
+    }
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    // No block was lost or handed out twice.
+    for (std::size_t corruptBlockCount : corruptBlockCounts) {
+        REQUIRE(corruptBlockCount == 0);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 16);
+    REQUIRE(memCache.getCombinedRequestCount() >= memCache.getCombineCount());
+}
@@ -2,9 +2,15 @@
 // Created by feher on 1.8.2018.
 //
 
+#include <chrono>
 #include <thread>
 #include <iostream>
 #include <random>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <poll.h>
 
 #include "catch.hpp"
 
@@ -34,7 +40,7 @@ TEST_CASE("LockFreeLinkedMemCache: Acquire decrements free block count", "[LockF
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<LinkedMemBlock> block{memCache.acquire()};
+    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
     REQUIRE(memCache.getFreeBlocksCount() == 2);
 }
 
@@ -44,7 +50,7 @@ TEST_CASE("LockFreeLinkedMemCache: Release increments free block count", "[LockF
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<LinkedMemBlock> block{new LinkedMemBlock{sizeof(PlainOldData)}};
+    std::unique_ptr<LinkedMemBlock> block{LinkedMemBlock::create(sizeof(PlainOldData))};
     memCache.release(std::move(block));
     REQUIRE(memCache.getFreeBlocksCount() == 4);
 }
@@ -55,7 +61,7 @@ TEST_CASE("LockFreeLinkedMemCache: Upkeep allocates at least minFreeBlocks block
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<LinkedMemBlock> block{memCache.acquire()};
+    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
     REQUIRE(memCache.getFreeBlocksCount() == 2);
 
     memCache.upkeep();
@@ -68,7 +74,7 @@ TEST_CASE("LockFreeLinkedMemCache: Upkeep releases unnecessary blocks", "[LockFr
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<LinkedMemBlock> block{memCache.acquire()};
+    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
     REQUIRE(memCache.getFreeBlocksCount() == 2);
 
     memCache.upkeep();
@@ -80,3 +86,606 @@ TEST_CASE("LockFreeLinkedMemCache: Upkeep releases unnecessary blocks", "[LockFr
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 }
+
+TEST_CASE("LockFreeLinkedMemCache: Block payload follows the header in the same allocation", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{1, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+    REQUIRE(block != nullptr);
+
+    auto header = reinterpret_cast<uint8_t *>(block.get());
+    auto payload = block->getAs<uint8_t>();
+    REQUIRE(payload == header + blockPayloadOffset<LinkedMemBlock>());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(payload) % alignof(PlainOldData) == 0);
+
+    block->getAs<PlainOldData>()->set(42);
+    REQUIRE(block->getAs<PlainOldData>()->verify(42));
+    memCache.release(std::move(block));
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Blocks are carved from slabs", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData)};
+    REQUIRE(memCache.getSlabCount() == 0);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getSlabCount() == 1);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Fully free slab is returned to the system", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getSlabCount() == 1);
+
+    // Move every block into another cache which discards them.
+    LockFreeLinkedMemCache otherMemCache{0, sizeof(PlainOldData)};
+    for (PooledBlock<LinkedMemBlock> block{memCache.acquire()}; block != nullptr; block = memCache.acquire()) {
+        otherMemCache.release(std::move(block));
+    }
+    REQUIRE(memCache.getSlabCount() == 1);
+
+    otherMemCache.upkeep();
+    REQUIRE(memCache.getSlabCount() == 0);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Blocks may outlive the cache", "[LockFreeLinkedMemCache]") {
+    PooledBlock<LinkedMemBlock> block{};
+    {
+        LockFreeLinkedMemCache memCache{3, sizeof(PlainOldData)};
+        memCache.upkeep();
+        block = memCache.acquire();
+    }
+    REQUIRE(block != nullptr);
+    block->getAs<PlainOldData>()->set(7);
+    REQUIRE(block->getAs<PlainOldData>()->verify(7));
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Small pages are reported as small pages", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getPageBacking() == PageBacking::SmallPages);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Huge pages fall back to weaker backings", "[LockFreeLinkedMemCache]") {
+    // The backing we get depends on the system. Whatever it is, it must be
+    // reported and the blocks must be usable.
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData), defaultBlockAlignment, PageBacking::HugeTlbPages};
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+    REQUIRE(memCache.getSlabCount() == 1);
+
+    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+    block->getAs<PlainOldData>()->set(42);
+    REQUIRE(block->getAs<PlainOldData>()->verify(42));
+    memCache.release(std::move(block));
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Blocks are aligned to the requested alignment", "[LockFreeLinkedMemCache]") {
+    for (std::size_t alignment : {std::size_t{64}, std::size_t{128}, std::size_t{4096}}) {
+        LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData), alignment};
+        memCache.upkeep();
+        REQUIRE(memCache.getAlignment() == alignment);
+
+        std::vector<PooledBlock<LinkedMemBlock>> blocks{};
+        for (PooledBlock<LinkedMemBlock> block{memCache.acquire()}; block != nullptr; block = memCache.acquire()) {
+            blocks.push_back(std::move(block));
+        }
+        REQUIRE(blocks.size() == 10);
+
+        std::vector<std::uintptr_t> payloads{};
+        for (auto & block : blocks) {
+            auto payload = reinterpret_cast<std::uintptr_t>(block->getAs<uint8_t>());
+            REQUIRE(payload % alignment == 0);
+            payloads.push_back(payload);
+        }
+
+        // No two payloads share a cache line.
+        std::sort(payloads.begin(), payloads.end());
+        for (std::size_t i{1}; i < payloads.size(); ++i) {
+            REQUIRE(payloads[i] - payloads[i - 1] >= alignment);
+        }
+    }
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Alignment must be a power of two", "[LockFreeLinkedMemCache]") {
+    REQUIRE_THROWS_AS((LockFreeLinkedMemCache{10, sizeof(PlainOldData), 48}), std::invalid_argument);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire and release a batch", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    LinkedMemBlockChain chain{memCache.acquireBatch(64)};
+    REQUIRE(chain.getLength() == 64);
+    REQUIRE(chain.getLast()->next == nullptr);
+    REQUIRE(memCache.getFreeBlocksCount() == 36);
+
+    PooledBlock<LinkedMemBlock> block{chain.popFromFront()};
+    block->getAs<PlainOldData>()->set(42);
+    chain.pushToFront(std::move(block));
+    REQUIRE(chain.getLength() == 64);
+
+    memCache.releaseBatch(std::move(chain));
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire a batch larger than the free blocks", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    LinkedMemBlockChain chain{memCache.acquireBatch(64)};
+    REQUIRE(chain.getLength() == 10);
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(memCache.acquireBatch(64).isEmpty());
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Release an empty batch", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    memCache.releaseBatch(LinkedMemBlockChain{});
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Dropped block goes back to the cache", "[LockFreeLinkedMemCache]") {
+    static_assert(sizeof(PooledBlock<LinkedMemBlock>) == sizeof(LinkedMemBlock *), "PooledBlock must be one pointer wide");
+
+    LockFreeLinkedMemCache memCache{3, sizeof(PlainOldData)};
+    memCache.upkeep();
+    {
+        PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+        REQUIRE(memCache.getFreeBlocksCount() == 2);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    try {
+        PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+        throw std::runtime_error{"Lost on an exception path"};
+    } catch (const std::runtime_error &) {
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+    REQUIRE(memCache.getSlabCount() == 1);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Dropped block goes back to the cache that carved it", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{3, sizeof(PlainOldData)};
+    memCache.upkeep();
+    LockFreeLinkedMemCache otherMemCache{0, sizeof(PlainOldData)};
+
+    otherMemCache.release(memCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 2);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+
+    otherMemCache.acquire();
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 0);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Multiple threads acquire and release", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{16, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < 4; ++threadIndex) {
+        userThreads.emplace_back([&memCache] {
+            for (int i{0}; i < 100000; ++i) {
+                memCache.release(memCache.acquire());
+            }
+        });
+    }
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    // No block was lost or handed out twice.
+    REQUIRE(memCache.getFreeBlocksCount() == 16);
+    REQUIRE(memCache.getSlabCount() == 1);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Surplus blocks wait until no thread may read them", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    LinkedMemBlockChain chain{memCache.acquireBatch(10)};
+    memCache.upkeep();
+    memCache.releaseBatch(std::move(chain));
+    REQUIRE(memCache.getFreeBlocksCount() == 20);
+
+    {
+        // As if a user thread was in the middle of a pop.
+        EpochReclamation::Guard guard{};
+        memCache.upkeep();
+        REQUIRE(memCache.getFreeBlocksCount() == 10);
+        REQUIRE(memCache.getRetiredBlocksCount() == 10);
+    }
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+    REQUIRE(memCache.getRetiredBlocksCount() == 0);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Upkeep shrinks while threads acquire and release", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{16, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    std::atomic<bool> isTestOver{false};
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < 4; ++threadIndex) {
+        userThreads.emplace_back([&memCache, &isTestOver] {
+            std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+            while (!isTestOver.load()) {
+                for (int i{0}; i < 8; ++i) {
+                    acquiredBlocks.push_back(memCache.acquire());
+                }
+                acquiredBlocks.clear();
+            }
+        });
+    }
+    // Every upkeep() grows while the blocks are out and shrinks when they are back.
+    for (int i{0}; i < 1000; ++i) {
+        memCache.upkeep();
+    }
+    isTestOver.store(true);
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 16);
+    REQUIRE(memCache.getRetiredBlocksCount() == 0);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Allocated blocks are free, retired or acquired", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount() == 10);
+
+    LinkedMemBlockChain chain{memCache.acquireBatch(4)};
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount() == memCache.getFreeBlocksCount() + chain.getLength());
+
+    {
+        EpochReclamation::Guard guard{};
+        memCache.releaseBatch(std::move(chain));
+        memCache.upkeep();
+        REQUIRE(memCache.getRetiredBlocksCount() == 4);
+        REQUIRE(memCache.getAllocatedBlocksCount() == memCache.getFreeBlocksCount() + memCache.getRetiredBlocksCount());
+    }
+
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount() == 10);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: No CAS retries without contention", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    for (int i{0}; i < 1000; ++i) {
+        memCache.release(memCache.acquire());
+    }
+    REQUIRE(memCache.getCasRetryCount() == 0);
+    REQUIRE(memCache.getEliminationCount() == 0);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Eliminated blocks are not lost", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{16, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < 8; ++threadIndex) {
+        userThreads.emplace_back([&memCache] {
+            for (int i{0}; i < 100000; ++i) {
+                PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+                if (block != nullptr) {
+                    memCache.release(std::move(block));
+                }
+            }
+        });
+    }
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    // The eliminations never exceed the retries that offered or took a block.
+    REQUIRE(memCache.getEliminationCount() <= memCache.getCasRetryCount());
+    REQUIRE(memCache.getFreeBlocksCount() == 16);
+    REQUIRE(memCache.getFreeBlocksCount() == memCache.getAllocatedBlocksCount());
+    LinkedMemBlockChain chain{memCache.acquireBatch(32)};
+    REQUIRE(chain.getLength() == 16);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire with timeout from a cache with free blocks", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{1, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.acquireFor(std::chrono::seconds(10)) != nullptr);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire with timeout times out on an empty cache", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{1, sizeof(PlainOldData)};
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(memCache.acquireFor(std::chrono::milliseconds(20)) == nullptr);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+    REQUIRE(memCache.acquireFor(std::chrono::milliseconds(0)) == nullptr);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire with timeout is woken by release", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{1, sizeof(PlainOldData)};
+    memCache.upkeep();
+    PooledBlock<LinkedMemBlock> block{memCache.acquire()};
+
+    std::thread releaserThread{[&memCache, &block] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        memCache.release(std::move(block));
+    }};
+    PooledBlock<LinkedMemBlock> acquiredBlock{memCache.acquireFor(std::chrono::seconds(10))};
+    releaserThread.join();
+    REQUIRE(acquiredBlock != nullptr);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire with timeout is woken by upkeep", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{4, sizeof(PlainOldData)};
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks(4);
+    std::vector<std::thread> userThreads{};
+    for (PooledBlock<LinkedMemBlock> & acquiredBlock : acquiredBlocks) {
+        userThreads.emplace_back([&memCache, &acquiredBlock] {
+            acquiredBlock = memCache.acquireFor(std::chrono::seconds(10));
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    memCache.upkeep();
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+    for (PooledBlock<LinkedMemBlock> & acquiredBlock : acquiredBlocks) {
+        REQUIRE(acquiredBlock != nullptr);
+    }
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Acquire below the low watermark signals that upkeep is needed", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getLowWatermark() == 2);
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    acquiredBlocks.push_back(memCache.acquire());
+    acquiredBlocks.push_back(memCache.acquire());
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    acquiredBlocks.push_back(memCache.acquire());
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    // Waiting clears the signal.
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::milliseconds(1)));
+
+    memCache.setLowWatermark(0);
+    acquiredBlocks.push_back(memCache.acquire());
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    // But running dry always signals.
+    REQUIRE(memCache.acquire() == nullptr);
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Short acquire batch signals that upkeep is needed", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    memCache.setLowWatermark(0);
+
+    LinkedMemBlockChain chain{memCache.acquireBatch(3)};
+    REQUIRE(chain.getLength() == 3);
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    LinkedMemBlockChain shortChain{memCache.acquireBatch(3)};
+    REQUIRE(shortChain.getLength() == 1);
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    REQUIRE(memCache.acquireBatch(1).getLength() == 0);
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Waiting for upkeep is woken by acquire", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    bool isUpkeepNeeded{false};
+    std::thread upkeeperThread{[&memCache, &isUpkeepNeeded] {
+        isUpkeepNeeded = memCache.waitForUpkeepNeeded(std::chrono::seconds(10));
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    acquiredBlocks.push_back(memCache.acquire());
+    acquiredBlocks.push_back(memCache.acquire());
+    acquiredBlocks.push_back(memCache.acquire());
+    upkeeperThread.join();
+    REQUIRE(isUpkeepNeeded);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Upkeep needed fd is readable while upkeep is needed", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    const int fd{memCache.getUpkeepNeededFd()};
+    REQUIRE(fd >= 0);
+    REQUIRE(memCache.getUpkeepNeededFd() == fd);
+
+    auto isReadable = [fd] {
+        pollfd pollFd{fd, POLLIN, 0};
+        return poll(&pollFd, 1, 0) == 1 && (pollFd.revents & POLLIN) != 0;
+    };
+    REQUIRE_FALSE(isReadable());
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 4; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    REQUIRE(isReadable());
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    REQUIRE_FALSE(isReadable());
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Auto-tuning follows the demand", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{4, sizeof(PlainOldData)};
+    REQUIRE_FALSE(memCache.isAutoTuning());
+    memCache.enableAutoTuning(4, 1000);
+    REQUIRE(memCache.isAutoTuning());
+    memCache.upkeep();
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 20; ++cycle) {
+        for (int i{0}; i < 50; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+    }
+    const std::size_t busyMinFreeBlocks{memCache.getMinFreeBlocks()};
+    REQUIRE(busyMinFreeBlocks >= 50);
+    REQUIRE(busyMinFreeBlocks <= 100);
+    REQUIRE(memCache.getFreeBlocksCount() == busyMinFreeBlocks);
+    REQUIRE(memCache.getLowWatermark() == busyMinFreeBlocks / 2);
+
+    acquiredBlocks.clear();
+    for (int cycle{0}; cycle < 40; ++cycle) {
+        memCache.upkeep();
+    }
+    REQUIRE(memCache.getMinFreeBlocks() == 4);
+    REQUIRE(memCache.getFreeBlocksCount() == 4);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Auto-tuning counts failed acquires", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{0, sizeof(PlainOldData)};
+    memCache.enableAutoTuning(0, 1000);
+    memCache.upkeep();
+    for (int i{0}; i < 10; ++i) {
+        REQUIRE(memCache.acquire() == nullptr);
+    }
+    memCache.upkeep();
+    REQUIRE(memCache.getMinFreeBlocks() > 0);
+    REQUIRE(memCache.getFreeBlocksCount() == memCache.getMinFreeBlocks());
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Auto-tuning stays between floor and ceiling", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE_THROWS_AS(memCache.enableAutoTuning(20, 10), std::invalid_argument);
+    memCache.enableAutoTuning(8, 16);
+    memCache.upkeep();
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 10; ++cycle) {
+        for (int i{0}; i < 100; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+    }
+    acquiredBlocks.clear();
+    for (int cycle{0}; cycle < 40; ++cycle) {
+        memCache.upkeep();
+    }
+
+    const auto history = memCache.getMinFreeBlocksHistory();
+    REQUIRE(history.size() == 51);
+    REQUIRE(*std::min_element(history.begin(), history.end()) == 8);
+    REQUIRE(*std::max_element(history.begin(), history.end()) == 16);
+    REQUIRE(history.back() == 8);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Upkeep shrinks only above the high watermark", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.getHighWatermark() == 10);
+    memCache.setHighWatermark(20);
+    REQUIRE(memCache.getHighWatermark() == 20);
+    memCache.upkeep();
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 5; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+    acquiredBlocks.clear();
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 15);
+
+    for (int i{0}; i < 15; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    memCache.upkeep();
+    acquiredBlocks.clear();
+    REQUIRE(memCache.getFreeBlocksCount() == 25);
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Upkeep frees at most maxShrinkFraction of the surplus", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.getMaxShrinkFraction() == 1.0);
+    REQUIRE_THROWS_AS(memCache.setMaxShrinkFraction(0.0), std::invalid_argument);
+    REQUIRE_THROWS_AS(memCache.setMaxShrinkFraction(1.5), std::invalid_argument);
+    memCache.setMaxShrinkFraction(0.5);
+    REQUIRE(memCache.getMaxShrinkFraction() == 0.5);
+    memCache.upkeep();
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 3; ++cycle) {
+        for (int i{0}; i < 10; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+    }
+    acquiredBlocks.clear();
+    REQUIRE(memCache.getFreeBlocksCount() == 40);
+
+    std::vector<std::size_t> freeBlocksCounts{};
+    for (int cycle{0}; cycle < 6; ++cycle) {
+        memCache.upkeep();
+        freeBlocksCounts.push_back(memCache.getFreeBlocksCount());
+    }
+    REQUIRE(freeBlocksCounts == std::vector<std::size_t>{25, 17, 13, 11, 10, 10});
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Hysteresis reduces allocations under oscillating load", "[LockFreeLinkedMemCache]") {
+    auto countAllocations = [](std::size_t highWatermark, double maxShrinkFraction) {
+        LockFreeLinkedMemCache memCache{20, sizeof(PlainOldData)};
+        memCache.setHighWatermark(highWatermark);
+        memCache.setMaxShrinkFraction(maxShrinkFraction);
+        memCache.upkeep();
+
+        // The acquired blocks follow a sine wave between 0 and 100, with a
+        // period of 20 upkeep() cycles.
+        std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+        for (int cycle{0}; cycle < 200; ++cycle) {
+            const auto acquiredBlockCount = static_cast<std::size_t>(50.0 + 50.0 * std::sin(cycle * 3.14159265 / 10.0));
+            while (acquiredBlocks.size() > acquiredBlockCount) {
+                acquiredBlocks.pop_back();
+            }
+            while (acquiredBlocks.size() < acquiredBlockCount) {
+                acquiredBlocks.push_back(memCache.acquire());
+            }
+            memCache.upkeep();
+        }
+        return memCache.getAllocationCount();
+    };
+
+    const std::size_t exactAllocationCount{countAllocations(20, 1.0)};
+    const std::size_t hysteresisAllocationCount{countAllocations(120, 0.25)};
+    REQUIRE(hysteresisAllocationCount * 4 < exactAllocationCount);
+}
+
+TEST_CASE("LockFreeLinkedMemCache: Auto-tuning keeps the ratio of the high watermark", "[LockFreeLinkedMemCache]") {
+    LockFreeLinkedMemCache memCache{200, sizeof(PlainOldData)};
+    memCache.setHighWatermark(300);
+    memCache.setMaxShrinkFraction(0.1);
+    memCache.enableAutoTuning(0, 100000);
+    auto isRatioKept = [&memCache] {
+        const std::size_t minFreeBlocks{memCache.getMinFreeBlocks()};
+        return memCache.getHighWatermark() == static_cast<std::size_t>(std::llround(1.5 * minFreeBlocks));
+    };
+
+    for (int cycle{0}; cycle < 60; ++cycle) {
+        memCache.upkeep();
+        REQUIRE(isRatioKept());
+    }
+    REQUIRE(memCache.getMinFreeBlocks() == 1);
+    REQUIRE(memCache.getHighWatermark() == 2);
+
+    std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 20; ++cycle) {
+        for (int i{0}; i < 100; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+        REQUIRE(isRatioKept());
+    }
+    REQUIRE(memCache.getMinFreeBlocks() >= 100);
+    REQUIRE(memCache.getHighWatermark() > memCache.getMinFreeBlocks());
+}
@@ -2,9 +2,17 @@
 // Created by feher on 1.8.2018.
 //
 
+#include <chrono>
 #include <thread>
 #include <iostream>
 #include <random>
+#include <algorithm>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <stdexcept>
+#include <poll.h>
 #include <atomic>
 
 #include "catch.hpp"
@@ -35,7 +43,7 @@ TEST_CASE("MemCache: Acquire decrements free block count", "[MemCache]") {
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<MemBlock> block{memCache.acquire()};
+    PooledBlock<MemBlock> block{memCache.acquire()};
     REQUIRE(memCache.getFreeBlocksCount() == 2);
 }
 
@@ -45,9 +53,15 @@ TEST_CASE("MemCache: Release increments free block count", "[MemCache]") {
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<MemBlock> block{new MemBlock{sizeof(PlainOldData)}};
+    PooledBlock<MemBlock> block{memCache.acquire()};
+    REQUIRE(memCache.getFreeBlocksCount() == 2);
     memCache.release(std::move(block));
-    REQUIRE(memCache.getFreeBlocksCount() == 4);
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    // A block without a cache is deleted.
+    std::unique_ptr<MemBlock> ownerlessBlock{MemBlock::create(sizeof(PlainOldData))};
+    memCache.release(std::move(ownerlessBlock));
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
 }
 
 TEST_CASE("MemCache: Upkeep allocates at least minFreeBlocks blocks", "[MemCache]") {
@@ -56,7 +70,7 @@ TEST_CASE("MemCache: Upkeep allocates at least minFreeBlocks blocks", "[MemCache
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<MemBlock> block{memCache.acquire()};
+    PooledBlock<MemBlock> block{memCache.acquire()};
     REQUIRE(memCache.getFreeBlocksCount() == 2);
 
     memCache.upkeep();
@@ -69,7 +83,7 @@ TEST_CASE("MemCache: Upkeep releases unnecessary blocks", "[MemCache]") {
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 
-    std::unique_ptr<MemBlock> block = memCache.acquire();
+    PooledBlock<MemBlock> block = memCache.acquire();
     REQUIRE(memCache.getFreeBlocksCount() == 2);
 
     memCache.upkeep();
@@ -81,3 +95,499 @@ TEST_CASE("MemCache: Upkeep releases unnecessary blocks", "[MemCache]") {
     memCache.upkeep();
     REQUIRE(memCache.getFreeBlocksCount() == 3);
 }
+
+TEST_CASE("MemCache: Block payload follows the header in the same allocation", "[MemCache]") {
+    MemCache memCache{1, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    PooledBlock<MemBlock> block{memCache.acquire()};
+    REQUIRE(block != nullptr);
+
+    auto header = reinterpret_cast<uint8_t *>(block.get());
+    auto payload = block->getAs<uint8_t>();
+    REQUIRE(payload == header + blockPayloadOffset<MemBlock>());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(payload) % alignof(PlainOldData) == 0);
+
+    block->getAs<PlainOldData>()->set(42);
+    REQUIRE(block->getAs<PlainOldData>()->verify(42));
+    memCache.release(std::move(block));
+}
+
+TEST_CASE("MemCache: Blocks are carved from slabs", "[MemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    REQUIRE(memCache.getSlabCount() == 0);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getSlabCount() == 1);
+}
+
+TEST_CASE("MemCache: Fully free slab is returned to the system", "[MemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getSlabCount() == 1);
+
+    // Let upkeep() delete every free block.
+    memCache.enableAutoTuning(0, 0);
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(memCache.getSlabCount() == 0);
+}
+
+TEST_CASE("MemCache: Blocks of another cache go back to their owner", "[MemCache]") {
+    MemCache memCache{0, sizeof(PlainOldData)};
+    MemCache otherMemCache{2, sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 2);
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    blocks.push_back(otherMemCache.acquire());
+    blocks.push_back(otherMemCache.acquire());
+    memCache.releaseBatch(blocks);
+    REQUIRE(blocks.empty());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 2);
+}
+
+TEST_CASE("MemCache: Small pages are reported as small pages", "[MemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getPageBacking() == PageBacking::SmallPages);
+}
+
+TEST_CASE("MemCache: Huge pages fall back to weaker backings", "[MemCache]") {
+    // The backing we get depends on the system. Whatever it is, it must be
+    // reported and the blocks must be usable.
+    MemCache memCache{100, sizeof(PlainOldData), defaultBlockAlignment, PageBacking::HugeTlbPages};
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+    REQUIRE(memCache.getSlabCount() == 1);
+
+    PooledBlock<MemBlock> block{memCache.acquire()};
+    block->getAs<PlainOldData>()->set(42);
+    REQUIRE(block->getAs<PlainOldData>()->verify(42));
+    memCache.release(std::move(block));
+}
+
+TEST_CASE("MemCache: Transparent huge pages are reported only when confirmed", "[MemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData), defaultBlockAlignment, PageBacking::TransparentHugePages};
+    memCache.upkeep();
+    const PageBacking backing{memCache.getPageBacking()};
+    REQUIRE(backing != PageBacking::HugeTlbPages);
+    REQUIRE(std::string{toString(backing)} != "unknown");
+
+    std::ifstream file{"/sys/kernel/mm/transparent_hugepage/enabled"};
+    std::string modes{};
+    std::getline(file, modes);
+    if (modes.find("[never]") != std::string::npos) {
+        REQUIRE(backing == PageBacking::SmallPages);
+    }
+}
+
+TEST_CASE("MemCache: Blocks are aligned to the requested alignment", "[MemCache]") {
+    for (std::size_t alignment : {std::size_t{64}, std::size_t{128}, std::size_t{4096}}) {
+        MemCache memCache{10, sizeof(PlainOldData), alignment};
+        memCache.upkeep();
+        REQUIRE(memCache.getAlignment() == alignment);
+
+        std::vector<PooledBlock<MemBlock>> blocks{};
+        for (PooledBlock<MemBlock> block{memCache.acquire()}; block != nullptr; block = memCache.acquire()) {
+            blocks.push_back(std::move(block));
+        }
+        REQUIRE(blocks.size() == 10);
+
+        std::vector<std::uintptr_t> payloads{};
+        for (auto & block : blocks) {
+            auto payload = reinterpret_cast<std::uintptr_t>(block->getAs<uint8_t>());
+            REQUIRE(payload % alignment == 0);
+            payloads.push_back(payload);
+        }
+
+        // No two payloads share a cache line.
+        std::sort(payloads.begin(), payloads.end());
+        for (std::size_t i{1}; i < payloads.size(); ++i) {
+            REQUIRE(payloads[i] - payloads[i - 1] >= alignment);
+        }
+    }
+}
+
+TEST_CASE("MemCache: Alignment must be a power of two", "[MemCache]") {
+    REQUIRE_THROWS_AS((MemCache{10, sizeof(PlainOldData), 48}), std::invalid_argument);
+}
+
+TEST_CASE("MemCache: Acquire and release a batch", "[MemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    blocks.reserve(64);
+    REQUIRE(memCache.acquireBatch(blocks, 64) == 64);
+    REQUIRE(blocks.size() == 64);
+    REQUIRE(memCache.getFreeBlocksCount() == 36);
+    for (auto & block : blocks) {
+        REQUIRE(block != nullptr);
+    }
+
+    memCache.releaseBatch(blocks);
+    REQUIRE(blocks.empty());
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+
+TEST_CASE("MemCache: Acquire a batch larger than the free blocks", "[MemCache]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    REQUIRE(memCache.acquireBatch(blocks, 64) == 10);
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(memCache.acquireBatch(blocks, 64) == 0);
+    REQUIRE(blocks.size() == 10);
+}
+
+TEST_CASE("MemCache: Dropped block goes back to the cache", "[MemCache]") {
+    static_assert(sizeof(PooledBlock<MemBlock>) == sizeof(MemBlock *), "PooledBlock must be one pointer wide");
+
+    MemCache memCache{3, sizeof(PlainOldData)};
+    memCache.upkeep();
+    {
+        PooledBlock<MemBlock> block{memCache.acquire()};
+        REQUIRE(memCache.getFreeBlocksCount() == 2);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    try {
+        PooledBlock<MemBlock> block{memCache.acquire()};
+        throw std::runtime_error{"Lost on an exception path"};
+    } catch (const std::runtime_error &) {
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+    REQUIRE(memCache.getSlabCount() == 1);
+}
+
+TEST_CASE("MemCache: Dropped block goes back to the cache that carved it", "[MemCache]") {
+    MemCache memCache{3, sizeof(PlainOldData)};
+    memCache.upkeep();
+    MemCache otherMemCache{0, sizeof(PlainOldData)};
+
+    memCache.acquire();
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+
+    otherMemCache.release(memCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 3);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 0);
+}
+
+TEST_CASE("MemCache: Allocated blocks are free or acquired", "[MemCache]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount() == 10);
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    memCache.acquireBatch(blocks, 4);
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount() == memCache.getFreeBlocksCount() + blocks.size());
+
+    memCache.releaseBatch(blocks);
+    memCache.upkeep();
+    REQUIRE(memCache.getAllocatedBlocksCount() == 10);
+}
+
+TEST_CASE("MemCache: Acquire with timeout from a cache with free blocks", "[MemCache]") {
+    MemCache memCache{1, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.acquireFor(std::chrono::seconds(10)) != nullptr);
+}
+
+TEST_CASE("MemCache: Acquire with timeout times out on an empty cache", "[MemCache]") {
+    MemCache memCache{1, sizeof(PlainOldData)};
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(memCache.acquireFor(std::chrono::milliseconds(20)) == nullptr);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+    REQUIRE(memCache.acquireFor(std::chrono::milliseconds(0)) == nullptr);
+}
+
+TEST_CASE("MemCache: Acquire with timeout is woken by release", "[MemCache]") {
+    MemCache memCache{1, sizeof(PlainOldData)};
+    memCache.upkeep();
+    PooledBlock<MemBlock> block{memCache.acquire()};
+
+    std::thread releaserThread{[&memCache, &block] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        memCache.release(std::move(block));
+    }};
+    PooledBlock<MemBlock> acquiredBlock{memCache.acquireFor(std::chrono::seconds(10))};
+    releaserThread.join();
+    REQUIRE(acquiredBlock != nullptr);
+}
+
+TEST_CASE("MemCache: Acquire with timeout is woken by upkeep", "[MemCache]") {
+    MemCache memCache{4, sizeof(PlainOldData)};
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks(4);
+    std::vector<std::thread> userThreads{};
+    for (PooledBlock<MemBlock> & acquiredBlock : acquiredBlocks) {
+        userThreads.emplace_back([&memCache, &acquiredBlock] {
+            acquiredBlock = memCache.acquireFor(std::chrono::seconds(10));
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    memCache.upkeep();
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+    for (PooledBlock<MemBlock> & acquiredBlock : acquiredBlocks) {
+        REQUIRE(acquiredBlock != nullptr);
+    }
+}
+
+TEST_CASE("MemCache: Acquire below the low watermark signals that upkeep is needed", "[MemCache]") {
+    MemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    REQUIRE(memCache.getLowWatermark() == 2);
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    acquiredBlocks.push_back(memCache.acquire());
+    acquiredBlocks.push_back(memCache.acquire());
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    acquiredBlocks.push_back(memCache.acquire());
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    // Waiting clears the signal.
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::milliseconds(1)));
+
+    memCache.setLowWatermark(0);
+    acquiredBlocks.push_back(memCache.acquire());
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    // But running dry always signals.
+    REQUIRE(memCache.acquire() == nullptr);
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+}
+
+TEST_CASE("MemCache: Short acquire batch signals that upkeep is needed", "[MemCache]") {
+    MemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    memCache.setLowWatermark(0);
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    REQUIRE(memCache.acquireBatch(blocks, 3) == 3);
+    REQUIRE_FALSE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    REQUIRE(memCache.acquireBatch(blocks, 3) == 1);
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    REQUIRE(memCache.acquireBatch(blocks, 1) == 0);
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+}
+
+TEST_CASE("MemCache: Waiting for upkeep is woken by acquire", "[MemCache]") {
+    MemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+
+    bool isUpkeepNeeded{false};
+    std::thread upkeeperThread{[&memCache, &isUpkeepNeeded] {
+        isUpkeepNeeded = memCache.waitForUpkeepNeeded(std::chrono::seconds(10));
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    acquiredBlocks.push_back(memCache.acquire());
+    acquiredBlocks.push_back(memCache.acquire());
+    acquiredBlocks.push_back(memCache.acquire());
+    upkeeperThread.join();
+    REQUIRE(isUpkeepNeeded);
+}
+
+TEST_CASE("MemCache: Upkeep needed fd is readable while upkeep is needed", "[MemCache]") {
+    MemCache memCache{4, sizeof(PlainOldData)};
+    memCache.upkeep();
+    const int fd{memCache.getUpkeepNeededFd()};
+    REQUIRE(fd >= 0);
+    REQUIRE(memCache.getUpkeepNeededFd() == fd);
+
+    auto isReadable = [fd] {
+        pollfd pollFd{fd, POLLIN, 0};
+        return poll(&pollFd, 1, 0) == 1 && (pollFd.revents & POLLIN) != 0;
+    };
+    REQUIRE_FALSE(isReadable());
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 4; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    REQUIRE(isReadable());
+    REQUIRE(memCache.waitForUpkeepNeeded(std::chrono::nanoseconds(0)));
+    REQUIRE_FALSE(isReadable());
+}
+
+TEST_CASE("MemCache: Auto-tuning follows the demand", "[MemCache]") {
+    MemCache memCache{4, sizeof(PlainOldData)};
+    REQUIRE_FALSE(memCache.isAutoTuning());
+    memCache.enableAutoTuning(4, 1000);
+    REQUIRE(memCache.isAutoTuning());
+    memCache.upkeep();
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 20; ++cycle) {
+        for (int i{0}; i < 50; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+    }
+    const std::size_t busyMinFreeBlocks{memCache.getMinFreeBlocks()};
+    REQUIRE(busyMinFreeBlocks >= 50);
+    REQUIRE(busyMinFreeBlocks <= 100);
+    REQUIRE(memCache.getFreeBlocksCount() == busyMinFreeBlocks);
+    REQUIRE(memCache.getLowWatermark() == busyMinFreeBlocks / 2);
+
+    acquiredBlocks.clear();
+    for (int cycle{0}; cycle < 40; ++cycle) {
+        memCache.upkeep();
+    }
+    REQUIRE(memCache.getMinFreeBlocks() == 4);
+    REQUIRE(memCache.getFreeBlocksCount() == 4);
+}
+
+TEST_CASE("MemCache: Auto-tuning counts failed acquires", "[MemCache]") {
+    MemCache memCache{0, sizeof(PlainOldData)};
+    memCache.enableAutoTuning(0, 1000);
+    memCache.upkeep();
+    for (int i{0}; i < 10; ++i) {
+        REQUIRE(memCache.acquire() == nullptr);
+    }
+    memCache.upkeep();
+    REQUIRE(memCache.getMinFreeBlocks() > 0);
+    REQUIRE(memCache.getFreeBlocksCount() == memCache.getMinFreeBlocks());
+}
+
+TEST_CASE("MemCache: Auto-tuning stays between floor and ceiling", "[MemCache]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE_THROWS_AS(memCache.enableAutoTuning(20, 10), std::invalid_argument);
+    memCache.enableAutoTuning(8, 16);
+    memCache.upkeep();
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 10; ++cycle) {
+        for (int i{0}; i < 100; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+    }
+    acquiredBlocks.clear();
+    for (int cycle{0}; cycle < 40; ++cycle) {
+        memCache.upkeep();
+    }
+
+    const auto history = memCache.getMinFreeBlocksHistory();
+    REQUIRE(history.size() == 51);
+    REQUIRE(*std::min_element(history.begin(), history.end()) == 8);
+    REQUIRE(*std::max_element(history.begin(), history.end()) == 16);
+    REQUIRE(history.back() == 8);
+}
+
+TEST_CASE("MemCache: Upkeep shrinks only above the high watermark", "[MemCache]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.getHighWatermark() == 10);
+    memCache.setHighWatermark(20);
+    REQUIRE(memCache.getHighWatermark() == 20);
+    memCache.upkeep();
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 5; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+    acquiredBlocks.clear();
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 15);
+
+    for (int i{0}; i < 15; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    memCache.upkeep();
+    acquiredBlocks.clear();
+    REQUIRE(memCache.getFreeBlocksCount() == 25);
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+}
+
+TEST_CASE("MemCache: Upkeep frees at most maxShrinkFraction of the surplus", "[MemCache]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.getMaxShrinkFraction() == 1.0);
+    REQUIRE_THROWS_AS(memCache.setMaxShrinkFraction(0.0), std::invalid_argument);
+    REQUIRE_THROWS_AS(memCache.setMaxShrinkFraction(1.5), std::invalid_argument);
+    memCache.setMaxShrinkFraction(0.5);
+    REQUIRE(memCache.getMaxShrinkFraction() == 0.5);
+    memCache.upkeep();
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 3; ++cycle) {
+        for (int i{0}; i < 10; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+    }
+    acquiredBlocks.clear();
+    REQUIRE(memCache.getFreeBlocksCount() == 40);
+
+    std::vector<std::size_t> freeBlocksCounts{};
+    for (int cycle{0}; cycle < 6; ++cycle) {
+        memCache.upkeep();
+        freeBlocksCounts.push_back(memCache.getFreeBlocksCount());
+    }
+    REQUIRE(freeBlocksCounts == std::vector<std::size_t>{25, 17, 13, 11, 10, 10});
+}
+
+TEST_CASE("MemCache: Hysteresis reduces allocations under oscillating load", "[MemCache]") {
+    auto countAllocations = [](std::size_t highWatermark, double maxShrinkFraction) {
+        MemCache memCache{20, sizeof(PlainOldData)};
+        memCache.setHighWatermark(highWatermark);
+        memCache.setMaxShrinkFraction(maxShrinkFraction);
+        memCache.upkeep();
+
+        // The acquired blocks follow a sine wave between 0 and 100, with a
+        // period of 20 upkeep() cycles.
+        std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+        for (int cycle{0}; cycle < 200; ++cycle) {
+            const auto acquiredBlockCount = static_cast<std::size_t>(50.0 + 50.0 * std::sin(cycle * 3.14159265 / 10.0));
+            while (acquiredBlocks.size() > acquiredBlockCount) {
+                acquiredBlocks.pop_back();
+            }
+            while (acquiredBlocks.size() < acquiredBlockCount) {
+                acquiredBlocks.push_back(memCache.acquire());
+            }
+            memCache.upkeep();
+        }
+        return memCache.getAllocationCount();
+    };
+
+    const std::size_t exactAllocationCount{countAllocations(20, 1.0)};
+    const std::size_t hysteresisAllocationCount{countAllocations(120, 0.25)};
+    REQUIRE(hysteresisAllocationCount * 4 < exactAllocationCount);
+}
+
+TEST_CASE("MemCache: Auto-tuning keeps the ratio of the high watermark", "[MemCache]") {
+    MemCache memCache{200, sizeof(PlainOldData)};
+    memCache.setHighWatermark(300);
+    memCache.setMaxShrinkFraction(0.1);
+    memCache.enableAutoTuning(0, 100000);
+    auto isRatioKept = [&memCache] {
+        const std::size_t minFreeBlocks{memCache.getMinFreeBlocks()};
+        return memCache.getHighWatermark() == static_cast<std::size_t>(std::llround(1.5 * minFreeBlocks));
+    };
+
+    for (int cycle{0}; cycle < 60; ++cycle) {
+        memCache.upkeep();
+        REQUIRE(isRatioKept());
+    }
+    REQUIRE(memCache.getMinFreeBlocks() == 1);
+    REQUIRE(memCache.getHighWatermark() == 2);
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int cycle{0}; cycle < 20; ++cycle) {
+        for (int i{0}; i < 100; ++i) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+        memCache.upkeep();
+        REQUIRE(isRatioKept());
+    }
+    REQUIRE(memCache.getMinFreeBlocks() >= 100);
+    REQUIRE(memCache.getHighWatermark() > memCache.getMinFreeBlocks());
+}
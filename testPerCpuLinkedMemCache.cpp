@@ -0,0 +1,142 @@
+#include <functional>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "PerCpuLinkedMemCache.hpp"
+#include "PlainOldData.hpp"
+
+namespace {
+
+// Pins the calling thread to the first CPU it may run on and returns that CPU.
+unsigned pinToFirstAllowedCpu() {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    sched_getaffinity(0, sizeof(cpus), &cpus);
+    unsigned cpu{0};
+    while (!CPU_ISSET(cpu, &cpus)) {
+        ++cpu;
+    }
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    return cpu;
+}
+
+}
+
+TEST_CASE("PerCpuLinkedMemCache: Current CPU is a CPU of the system", "[PerCpuLinkedMemCache]") {
+    unsigned pinnedCpu{0};
+    unsigned currentCpu{0};
+    std::thread userThread{[&] {
+        pinnedCpu = pinToFirstAllowedCpu();
+        currentCpu = getCurrentCpu();
+    }};
+    userThread.join();
+
+    REQUIRE(currentCpu == pinnedCpu);
+    REQUIRE(currentCpu < getCpuCount());
+}
+
+TEST_CASE("PerCpuLinkedMemCache: Upkeep gives every CPU its share of minFreeBlocks", "[PerCpuLinkedMemCache]") {
+    PerCpuLinkedMemCache memCache{10, sizeof(PlainOldData), 4};
+    memCache.upkeep();
+    REQUIRE(memCache.getCpuListCount() == 4);
+    REQUIRE(memCache.getFreeBlocksCount(0) == 3);
+    REQUIRE(memCache.getFreeBlocksCount(1) == 3);
+    REQUIRE(memCache.getFreeBlocksCount(2) == 2);
+    REQUIRE(memCache.getFreeBlocksCount(3) == 2);
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+}
+
+TEST_CASE("PerCpuLinkedMemCache: One list per CPU by default", "[PerCpuLinkedMemCache]") {
+    PerCpuLinkedMemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.getCpuListCount() == getCpuCount());
+}
+
+TEST_CASE("PerCpuLinkedMemCache: Acquire and release use the list of the current CPU", "[PerCpuLinkedMemCache]") {
+    PerCpuLinkedMemCache memCache{8, sizeof(PlainOldData), 4};
+    memCache.upkeep();
+
+    // Pinned, so the current CPU does not change under the test.
+    std::size_t cpuListIndex{0};
+    std::vector<PooledBlock<LinkedMemBlock>> blocks{};
+    auto runPinned = [&cpuListIndex](const std::function<void()> & function) {
+        std::thread userThread{[&] {
+            cpuListIndex = pinToFirstAllowedCpu() % 4;
+            function();
+        }};
+        userThread.join();
+    };
+
+    std::size_t currentCpuListIndex{0};
+    runPinned([&] {
+        currentCpuListIndex = memCache.getCurrentCpuListIndex();
+        blocks.push_back(memCache.acquire());
+        blocks.push_back(memCache.acquire());
+    });
+    REQUIRE(currentCpuListIndex == cpuListIndex);
+    REQUIRE(memCache.getFreeBlocksCount(cpuListIndex) == 0);
+    REQUIRE(memCache.getStealCount() == 0);
+
+    // The list of this CPU is empty now.
+    runPinned([&] {
+        blocks.push_back(memCache.acquire());
+    });
+    REQUIRE(blocks.back() != nullptr);
+    REQUIRE(memCache.getStealCount() == 1);
+    REQUIRE(memCache.getFreeBlocksCount((cpuListIndex + 1) % 4) == 1);
+
+    runPinned([&] {
+        for (PooledBlock<LinkedMemBlock> & block : blocks) {
+            memCache.release(std::move(block));
+        }
+    });
+    REQUIRE(memCache.getFreeBlocksCount(cpuListIndex) == 3);
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 8);
+}
+
+TEST_CASE("PerCpuLinkedMemCache: Idle blocks do not grow with the number of threads", "[PerCpuLinkedMemCache]") {
+    PerCpuLinkedMemCache memCache{16, sizeof(PlainOldData), 2};
+    memCache.upkeep();
+
+    std::vector<std::thread> userThreads{};
+    for (int threadIndex{0}; threadIndex < 32; ++threadIndex) {
+        userThreads.emplace_back([&memCache] {
+            for (int i{0}; i < 1000; ++i) {
+                memCache.release(memCache.acquire());
+            }
+        });
+    }
+    for (std::thread & userThread : userThreads) {
+        userThread.join();
+    }
+
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 16);
+}
+
+TEST_CASE("PerCpuLinkedMemCache: Release a block of a different size", "[PerCpuLinkedMemCache]") {
+    PerCpuLinkedMemCache memCache{4, sizeof(PlainOldData), 2};
+    LockFreeLinkedMemCache otherMemCache{1, 2 * sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+}
+
+TEST_CASE("PerCpuLinkedMemCache: Release a block of another cache of the same size", "[PerCpuLinkedMemCache]") {
+    PerCpuLinkedMemCache memCache{0, sizeof(PlainOldData), 2};
+    LockFreeLinkedMemCache otherMemCache{1, sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+}
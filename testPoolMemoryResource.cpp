@@ -0,0 +1,152 @@
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+
+#include "catch.hpp"
+
+#include "LockFreeLinkedMemCache.hpp"
+#include "MemCache.hpp"
+#include "PoolMemoryResource.hpp"
+
+namespace {
+
+// Counts the allocations that reach the upstream resource.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t allocationCount{0};
+    std::size_t liveAllocationCount{0};
+
+protected:
+    void * do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocationCount;
+        ++liveAllocationCount;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void * memory, std::size_t bytes, std::size_t alignment) override {
+        --liveAllocationCount;
+        std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}
+
+TEST_CASE("PoolMemoryResource: List nodes come from the MemCache", "[PoolMemoryResource]") {
+    MemCache memCache{100, 64};
+    memCache.upkeep();
+    CountingResource upstream{};
+    PoolMemoryResource<MemCache> resource{memCache, &upstream};
+
+    {
+        std::pmr::list<int> list{&resource};
+        for (int i{0}; i < 50; ++i) {
+            list.push_back(i);
+        }
+        REQUIRE(memCache.getFreeBlocksCount() == 50);
+
+        int expected{0};
+        for (int value : list) {
+            REQUIRE(value == expected++);
+        }
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+    REQUIRE(upstream.allocationCount == 0);
+    REQUIRE(resource.getFallbackCount() == 0);
+}
+
+TEST_CASE("PoolMemoryResource: Map nodes come from the LockFreeLinkedMemCache", "[PoolMemoryResource]") {
+    LockFreeLinkedMemCache memCache{100, 128};
+    memCache.upkeep();
+    CountingResource upstream{};
+    PoolMemoryResource<LockFreeLinkedMemCache> resource{memCache, &upstream};
+
+    {
+        std::pmr::map<int, double> map{&resource};
+        for (int i{0}; i < 50; ++i) {
+            map[i] = i * 0.5;
+        }
+        REQUIRE(memCache.getFreeBlocksCount() == 50);
+        REQUIRE(map[42] == 21.0);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+    REQUIRE(upstream.allocationCount == 0);
+}
+
+TEST_CASE("PoolMemoryResource: Larger allocations go upstream", "[PoolMemoryResource]") {
+    MemCache memCache{100, 64};
+    memCache.upkeep();
+    CountingResource upstream{};
+    PoolMemoryResource<MemCache> resource{memCache, &upstream};
+
+    {
+        // The bucket array does not fit into a block, the nodes do.
+        std::pmr::unordered_map<int, int> map{&resource};
+        for (int i{0}; i < 50; ++i) {
+            map[i] = i;
+        }
+        REQUIRE(memCache.getFreeBlocksCount() == 50);
+        REQUIRE(upstream.allocationCount > 0);
+    }
+    REQUIRE(upstream.liveAllocationCount == 0);
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+
+TEST_CASE("PoolMemoryResource: Over-aligned allocations go upstream", "[PoolMemoryResource]") {
+    MemCache memCache{10, 64};
+    memCache.upkeep();
+    CountingResource upstream{};
+    PoolMemoryResource<MemCache> resource{memCache, &upstream};
+
+    void * memory{resource.allocate(32, 128)};
+    REQUIRE(reinterpret_cast<std::uintptr_t>(memory) % 128 == 0);
+    REQUIRE(upstream.allocationCount == 1);
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+    resource.deallocate(memory, 32, 128);
+    REQUIRE(upstream.liveAllocationCount == 0);
+}
+
+TEST_CASE("PoolMemoryResource: Empty cache falls back to upstream", "[PoolMemoryResource]") {
+    MemCache memCache{2, 64};
+    memCache.upkeep();
+    CountingResource upstream{};
+    PoolMemoryResource<MemCache> resource{memCache, &upstream};
+
+    {
+        std::pmr::list<std::pmr::string> list{&resource};
+        for (int i{0}; i < 5; ++i) {
+            list.emplace_back("x");
+        }
+        REQUIRE(memCache.getFreeBlocksCount() == 0);
+        REQUIRE(resource.getFallbackCount() == 3);
+        REQUIRE(upstream.liveAllocationCount == 3);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 2);
+    REQUIRE(upstream.allocationCount == 3);
+    REQUIRE(upstream.liveAllocationCount == 0);
+}
+
+TEST_CASE("PoolMemoryResource: Empty cache falls back to upstream for over-aligned blocks", "[PoolMemoryResource]") {
+    LockFreeLinkedMemCache memCache{1, 64, 128};
+    memCache.upkeep();
+    CountingResource upstream{};
+    PoolMemoryResource<LockFreeLinkedMemCache> resource{memCache, &upstream};
+
+    void * pooled{resource.allocate(64, 128)};
+    void * fallback{resource.allocate(64, 128)};
+    REQUIRE(reinterpret_cast<std::uintptr_t>(fallback) % 128 == 0);
+    REQUIRE(resource.getFallbackCount() == 1);
+    REQUIRE(upstream.liveAllocationCount == 1);
+
+    resource.deallocate(fallback, 64, 128);
+    resource.deallocate(pooled, 64, 128);
+    REQUIRE(upstream.liveAllocationCount == 0);
+    REQUIRE(memCache.getFreeBlocksCount() == 1);
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include "SizeClassMemCache.hpp"
+#include "PlainOldData.hpp"
+
+TEST_CASE("SizeClassMemCache: Block sizes of the classes double", "[SizeClassMemCache]") {
+    SizeClassMemCache memCache{10, 16, 1000};
+    REQUIRE(memCache.getClassCount() == 7);
+    REQUIRE(memCache.getClassBlockSize(0) == 16);
+    REQUIRE(memCache.getClassBlockSize(1) == 32);
+    REQUIRE(memCache.getClassBlockSize(6) == 1024);
+}
+
+TEST_CASE("SizeClassMemCache: Upkeep allocates minFreeBlocks in every class", "[SizeClassMemCache]") {
+    SizeClassMemCache memCache{10, 16, 256};
+    memCache.upkeep();
+    for (std::size_t i{0}; i < memCache.getClassCount(); ++i) {
+        REQUIRE(memCache.getFreeBlocksCount(i) == 10);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 10 * memCache.getClassCount());
+}
+
+TEST_CASE("SizeClassMemCache: Acquire picks the smallest class that fits", "[SizeClassMemCache]") {
+    SizeClassMemCache memCache{1, 16, 256};
+    memCache.upkeep();
+
+    const std::size_t sizes[]{0, 1, 16, 17, 32, 33, 100, 128, 129, 256};
+    const std::size_t classIndexes[]{0, 0, 0, 1, 1, 2, 3, 3, 4, 4};
+    for (std::size_t i{0}; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        PooledBlock<MemBlock> block{memCache.acquire(sizes[i])};
+        REQUIRE(block != nullptr);
+        REQUIRE(memCache.getFreeBlocksCount(classIndexes[i]) == 0);
+        memCache.release(std::move(block));
+        REQUIRE(memCache.getFreeBlocksCount(classIndexes[i]) == 1);
+    }
+}
+
+TEST_CASE("SizeClassMemCache: Acquire larger than the largest class", "[SizeClassMemCache]") {
+    SizeClassMemCache memCache{1, 16, 256};
+    memCache.upkeep();
+    REQUIRE(memCache.acquire(257) == nullptr);
+}
+
+TEST_CASE("SizeClassMemCache: Release returns the block to its class", "[SizeClassMemCache]") {
+    SizeClassMemCache memCache{2, 16, 256};
+    memCache.upkeep();
+
+    PooledBlock<MemBlock> small{memCache.acquire(sizeof(PlainOldData))};
+    PooledBlock<MemBlock> large{memCache.acquire(200)};
+    small->getAs<PlainOldData>()->set(1);
+    large->getAs<PlainOldData>()->set(2);
+    REQUIRE(memCache.getFreeBlocksCount() == 2 * memCache.getClassCount() - 2);
+
+    memCache.release(std::move(large));
+    memCache.release(std::move(small));
+    for (std::size_t i{0}; i < memCache.getClassCount(); ++i) {
+        REQUIRE(memCache.getFreeBlocksCount(i) == 2);
+    }
+}
+
+TEST_CASE("SizeClassMemCache: Foreign blocks are not released into a class", "[SizeClassMemCache]") {
+    SizeClassMemCache memCache{1, 16, 256};
+    memCache.upkeep();
+
+    memCache.release(MemBlock::create(16));
+    memCache.release(nullptr);
+
+    MemCache otherMemCache{1, 16};
+    otherMemCache.upkeep();
+    memCache.release(otherMemCache.acquire());
+
+    REQUIRE(memCache.getFreeBlocksCount() == memCache.getClassCount());
+}
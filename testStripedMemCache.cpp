@@ -0,0 +1,100 @@
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "StripedMemCache.hpp"
+#include "PlainOldData.hpp"
+
+TEST_CASE("StripedMemCache: Upkeep gives every shard its share of minFreeBlocks", "[StripedMemCache]") {
+    StripedMemCache memCache{10, sizeof(PlainOldData), 4};
+    memCache.upkeep();
+    REQUIRE(memCache.getShardCount() == 4);
+    REQUIRE(memCache.getFreeBlocksCount(0) == 3);
+    REQUIRE(memCache.getFreeBlocksCount(1) == 3);
+    REQUIRE(memCache.getFreeBlocksCount(2) == 2);
+    REQUIRE(memCache.getFreeBlocksCount(3) == 2);
+    REQUIRE(memCache.getFreeBlocksCount() == 10);
+}
+
+TEST_CASE("StripedMemCache: Shard count defaults to the hardware threads", "[StripedMemCache]") {
+    StripedMemCache memCache{10, sizeof(PlainOldData)};
+    REQUIRE(memCache.getShardCount() == std::max(1u, std::thread::hardware_concurrency()));
+}
+
+TEST_CASE("StripedMemCache: Acquire and release use the home shard", "[StripedMemCache]") {
+    StripedMemCache memCache{8, sizeof(PlainOldData), 4};
+    memCache.upkeep();
+    const std::size_t homeShardIndex{memCache.getHomeShardIndex()};
+
+    PooledBlock<MemBlock> block{memCache.acquire()};
+    REQUIRE(block != nullptr);
+    REQUIRE(memCache.getFreeBlocksCount(homeShardIndex) == 1);
+    memCache.release(std::move(block));
+    REQUIRE(memCache.getFreeBlocksCount(homeShardIndex) == 2);
+    REQUIRE(memCache.getStealCount() == 0);
+}
+
+TEST_CASE("StripedMemCache: Empty home shard steals from a neighbor", "[StripedMemCache]") {
+    StripedMemCache memCache{8, sizeof(PlainOldData), 4};
+    memCache.upkeep();
+    const std::size_t homeShardIndex{memCache.getHomeShardIndex()};
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    for (int i{0}; i < 3; ++i) {
+        blocks.push_back(memCache.acquire());
+        REQUIRE(blocks.back() != nullptr);
+    }
+    REQUIRE(memCache.getFreeBlocksCount(homeShardIndex) == 0);
+    REQUIRE(memCache.getFreeBlocksCount((homeShardIndex + 1) % 4) == 1);
+    REQUIRE(memCache.getStealCount() == 1);
+
+    for (int i{0}; i < 5; ++i) {
+        blocks.push_back(memCache.acquire());
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(memCache.acquire() == nullptr);
+
+    // Every block goes back to the shard that carved it.
+    for (PooledBlock<MemBlock> & block : blocks) {
+        memCache.release(std::move(block));
+    }
+    for (std::size_t i{0}; i < 4; ++i) {
+        REQUIRE(memCache.getFreeBlocksCount(i) == 2);
+    }
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount(homeShardIndex) == 2);
+    REQUIRE(memCache.getFreeBlocksCount() == 8);
+}
+
+TEST_CASE("StripedMemCache: Threads get different home shards", "[StripedMemCache]") {
+    StripedMemCache memCache{8, sizeof(PlainOldData), 4};
+    std::size_t homeShardIndexes[2];
+    for (std::size_t & homeShardIndex : homeShardIndexes) {
+        std::thread userThread{[&memCache, &homeShardIndex] {
+            homeShardIndex = memCache.getHomeShardIndex();
+        }};
+        userThread.join();
+    }
+    REQUIRE(homeShardIndexes[0] != homeShardIndexes[1]);
+}
+
+TEST_CASE("StripedMemCache: Release a block of a different size", "[StripedMemCache]") {
+    StripedMemCache memCache{4, sizeof(PlainOldData), 2};
+    MemCache otherMemCache{1, 2 * sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+}
+
+TEST_CASE("StripedMemCache: Release a block of another cache of the same size", "[StripedMemCache]") {
+    StripedMemCache memCache{0, 64, 2, 4096};
+    MemCache otherMemCache{1, 64, 16};
+    otherMemCache.upkeep();
+
+    memCache.release(otherMemCache.acquire());
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+}
@@ -0,0 +1,105 @@
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "LockFreeLinkedMemCache.hpp"
+#include "MemCache.hpp"
+#include "PlainOldData.hpp"
+#include "ThreadLocalMemCache.hpp"
+
+TEST_CASE("ThreadLocalMemCache: Acquire refills the local stack in a batch", "[ThreadLocalMemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    ThreadLocalMemCache<MemCache> threadLocalMemCache{memCache, 32};
+    REQUIRE(threadLocalMemCache.getBatchSize() == 16);
+
+    PooledBlock<MemBlock> block{threadLocalMemCache.acquire()};
+    REQUIRE(block != nullptr);
+    REQUIRE(memCache.getFreeBlocksCount() == 84);
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    for (int i{0}; i < 15; ++i) {
+        blocks.push_back(threadLocalMemCache.acquire());
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 84);
+
+    ThreadLocalMemCacheStats stats{threadLocalMemCache.getStats()};
+    REQUIRE(stats.acquireCount == 16);
+    REQUIRE(stats.localHitCount == 15);
+    REQUIRE(stats.refillCount == 1);
+    REQUIRE(stats.getLocalHitRate() == Approx(15.0 / 16));
+}
+
+TEST_CASE("ThreadLocalMemCache: Release flushes a batch when the local stack is full", "[ThreadLocalMemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    ThreadLocalMemCache<MemCache> threadLocalMemCache{memCache, 32, 8};
+
+    std::vector<PooledBlock<MemBlock>> blocks{};
+    memCache.acquireBatch(blocks, 33);
+    for (PooledBlock<MemBlock> & block : blocks) {
+        threadLocalMemCache.release(std::move(block));
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 67 + 8);
+    REQUIRE(threadLocalMemCache.getStats().flushCount == 1);
+
+    threadLocalMemCache.flush();
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+}
+
+TEST_CASE("ThreadLocalMemCache: Blocks go back to the cache when the thread exits", "[ThreadLocalMemCache]") {
+    MemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    ThreadLocalMemCache<MemCache> threadLocalMemCache{memCache, 32};
+
+    std::thread userThread{[&threadLocalMemCache] {
+        threadLocalMemCache.release(threadLocalMemCache.acquire());
+    }};
+    userThread.join();
+
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+    ThreadLocalMemCacheStats stats{threadLocalMemCache.getStats()};
+    REQUIRE(stats.acquireCount == 1);
+    REQUIRE(stats.refillCount == 1);
+}
+
+TEST_CASE("ThreadLocalMemCache: Blocks go back to the cache when the front-end is destroyed", "[ThreadLocalMemCache]") {
+    LockFreeLinkedMemCache memCache{100, sizeof(PlainOldData)};
+    memCache.upkeep();
+    {
+        ThreadLocalMemCache<LockFreeLinkedMemCache> threadLocalMemCache{memCache, 32};
+        threadLocalMemCache.release(threadLocalMemCache.acquire());
+        REQUIRE(memCache.getFreeBlocksCount() == 84);
+    }
+    REQUIRE(memCache.getFreeBlocksCount() == 100);
+
+    // A new front-end does not pick up the local stack of the old one.
+    ThreadLocalMemCache<LockFreeLinkedMemCache> threadLocalMemCache{memCache, 32};
+    REQUIRE(threadLocalMemCache.getStats().acquireCount == 0);
+}
+
+TEST_CASE("ThreadLocalMemCache: Acquire from empty cache", "[ThreadLocalMemCache]") {
+    LockFreeLinkedMemCache memCache{0, sizeof(PlainOldData)};
+    ThreadLocalMemCache<LockFreeLinkedMemCache> threadLocalMemCache{memCache};
+    REQUIRE(threadLocalMemCache.acquire() == nullptr);
+}
+
+TEST_CASE("ThreadLocalMemCache: Batch size must fit into the local stack", "[ThreadLocalMemCache]") {
+    MemCache memCache{0, sizeof(PlainOldData)};
+    REQUIRE_THROWS_AS(ThreadLocalMemCache<MemCache>(memCache, 32, 33), std::invalid_argument);
+    REQUIRE_THROWS_AS(ThreadLocalMemCache<MemCache>(memCache, 1), std::invalid_argument);
+}
+
+TEST_CASE("ThreadLocalMemCache: Release a block of another cache", "[ThreadLocalMemCache]") {
+    MemCache memCache{0, sizeof(PlainOldData)};
+    MemCache otherMemCache{1, sizeof(PlainOldData)};
+    otherMemCache.upkeep();
+    ThreadLocalMemCache<MemCache> threadLocalMemCache{memCache, 32};
+
+    threadLocalMemCache.release(otherMemCache.acquire());
+    REQUIRE(otherMemCache.getFreeBlocksCount() == 1);
+    threadLocalMemCache.flush();
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+}
@@ -0,0 +1,246 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "catch.hpp"
+
+#include "UpkeepService.hpp"
+#include "MemCache.hpp"
+#include "LockFreeLinkedMemCache.hpp"
+#include "FixedMemCache.hpp"
+#include "PlainOldData.hpp"
+
+// Polls condition for at most 10 seconds.
+template<typename Condition>
+static bool waitUntil(Condition condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST_CASE("UpkeepService: Added caches are upkept", "[UpkeepService]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    LockFreeLinkedMemCache lockFreeMemCache{20, sizeof(PlainOldData)};
+    FixedMemCache<sizeof(PlainOldData)> fixedMemCache{30};
+
+    UpkeepService upkeepService{2};
+    REQUIRE(upkeepService.getThreadCount() == 2);
+    upkeepService.add(memCache);
+    upkeepService.add(lockFreeMemCache);
+    upkeepService.add(fixedMemCache);
+    upkeepService.add(memCache);
+    REQUIRE(upkeepService.getCacheCount() == 3);
+
+    REQUIRE(waitUntil([&] {
+        return memCache.getFreeBlocksCount() == 10 && lockFreeMemCache.getFreeBlocksCount() == 20
+               && fixedMemCache.getFreeBlocksCount() == 30;
+    }));
+    REQUIRE(upkeepService.getUpkeepCount() >= 3);
+
+    REQUIRE(upkeepService.remove(memCache));
+    REQUIRE(upkeepService.remove(lockFreeMemCache));
+    REQUIRE(upkeepService.remove(fixedMemCache));
+    REQUIRE_FALSE(upkeepService.remove(memCache));
+    REQUIRE(upkeepService.getCacheCount() == 0);
+}
+
+TEST_CASE("UpkeepService: A cache running low is upkept before its interval passes", "[UpkeepService]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    memCache.upkeep();
+    UpkeepService upkeepService{};
+    upkeepService.add(memCache);
+    // Idle, so the interval grows to the maximum.
+    REQUIRE(waitUntil([&] { return upkeepService.getInterval(memCache) == UpkeepService::maxInterval; }));
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 8; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    REQUIRE(waitUntil([&] { return memCache.getFreeBlocksCount() == 10; }));
+    // The signal shortens the interval.
+    REQUIRE(upkeepService.getInterval(memCache) < UpkeepService::maxInterval);
+}
+
+TEST_CASE("UpkeepService: A busy cache above minFreeBlocks keeps its interval", "[UpkeepService]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    // Keeps the free blocks far above minFreeBlocks while blocks are acquired.
+    memCache.setHighWatermark(100000);
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 100; ++i) {
+        memCache.upkeep();
+        for (int j{0}; j < 10; ++j) {
+            acquiredBlocks.push_back(memCache.acquire());
+        }
+    }
+    acquiredBlocks.clear();
+    memCache.upkeep();
+    REQUIRE(memCache.getFreeBlocksCount() == 1000);
+
+    std::atomic<bool> isTestOver{false};
+    std::thread userThread{[&] {
+        while (!isTestOver.load()) {
+            acquiredBlocks.push_back(memCache.acquire());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }};
+
+    std::chrono::nanoseconds interval{};
+    {
+        UpkeepService upkeepService{};
+        upkeepService.add(memCache);
+        // An idle cache reaches maxInterval within a few upkeep() calls.
+        std::this_thread::sleep_for(3 * UpkeepService::maxInterval);
+        interval = upkeepService.getInterval(memCache);
+    }
+    isTestOver.store(true);
+    userThread.join();
+    REQUIRE(interval < UpkeepService::maxInterval);
+}
+
+TEST_CASE("UpkeepService: A removed cache is not upkept", "[UpkeepService]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    UpkeepService upkeepService{};
+    upkeepService.add(memCache);
+    REQUIRE(waitUntil([&] { return memCache.getFreeBlocksCount() == 10; }));
+    REQUIRE(upkeepService.remove(memCache));
+
+    std::vector<PooledBlock<MemBlock>> acquiredBlocks{};
+    for (int i{0}; i < 10; ++i) {
+        acquiredBlocks.push_back(memCache.acquire());
+    }
+    std::this_thread::sleep_for(2 * UpkeepService::maxInterval);
+    REQUIRE(memCache.getFreeBlocksCount() == 0);
+    REQUIRE(upkeepService.getInterval(memCache) == std::chrono::nanoseconds::zero());
+}
+
+// Records the order of the upkeep() calls. Its first upkeep() blocks until
+// isGateOpen, so that the service sees all caches at once.
+struct RecordingCache {
+    int id;
+    std::size_t freeBlocksCount;
+    std::vector<int> & upkeepOrder;
+    std::atomic<bool> * isGateOpen;
+    std::atomic<bool> * isAtGate;
+
+    void upkeep() {
+        if (isGateOpen != nullptr) {
+            isAtGate->store(true);
+            while (!isGateOpen->load()) {
+                std::this_thread::yield();
+            }
+            isGateOpen = nullptr;
+        }
+        upkeepOrder.push_back(id);
+        freeBlocksCount = 10;
+    }
+    std::size_t getFreeBlocksCount() { return freeBlocksCount; }
+    std::size_t getMinFreeBlocks() { return 10; }
+    std::size_t getFailedAcquireCount() { return 0; }
+    bool waitForUpkeepNeeded(std::chrono::nanoseconds) { return false; }
+    int getUpkeepNeededFd() { return -1; }
+};
+
+TEST_CASE("UpkeepService: The most depleted cache goes first", "[UpkeepService]") {
+    std::vector<int> upkeepOrder{};
+    std::atomic<bool> isGateOpen{false};
+    std::atomic<bool> isAtGate{false};
+    RecordingCache gateCache{0, 10, upkeepOrder, &isGateOpen, &isAtGate};
+    RecordingCache fullCache{1, 9, upkeepOrder, nullptr, nullptr};
+    RecordingCache emptyCache{2, 0, upkeepOrder, nullptr, nullptr};
+    RecordingCache halfCache{3, 5, upkeepOrder, nullptr, nullptr};
+    {
+        UpkeepService upkeepService{1};
+        upkeepService.add(gateCache);
+        REQUIRE(waitUntil([&] { return isAtGate.load(); }));
+        upkeepService.add(fullCache);
+        upkeepService.add(emptyCache);
+        upkeepService.add(halfCache);
+        isGateOpen.store(true);
+        REQUIRE(waitUntil([&] { return upkeepService.getUpkeepCount() >= 4; }));
+    }
+    REQUIRE(upkeepOrder.size() >= 4);
+    REQUIRE(upkeepOrder[1] == 2);
+    REQUIRE(upkeepOrder[2] == 3);
+    REQUIRE(upkeepOrder[3] == 1);
+}
+
+TEST_CASE("UpkeepService: Threads may be pinned and niced", "[UpkeepService]") {
+    MemCache memCache{10, sizeof(PlainOldData)};
+    UpkeepService upkeepService{1, {0}, 19};
+    upkeepService.add(memCache);
+    REQUIRE(waitUntil([&] { return memCache.getFreeBlocksCount() == 10; }));
+}
+
+// Records the niceness of the service thread that runs its upkeep().
+struct NicenessRecordingCache {
+    std::atomic<int> niceness{-100};
+
+    void upkeep() {
+        niceness.store(getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid))));
+    }
+    std::size_t getFreeBlocksCount() { return 10; }
+    std::size_t getMinFreeBlocks() { return 10; }
+    std::size_t getFailedAcquireCount() { return 0; }
+    bool waitForUpkeepNeeded(std::chrono::nanoseconds) { return false; }
+    int getUpkeepNeededFd() { return -1; }
+};
+
+TEST_CASE("UpkeepService: Without a niceness the threads keep the niceness of the process", "[UpkeepService]") {
+    const int processNiceness{getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)))};
+    NicenessRecordingCache keptCache{};
+    NicenessRecordingCache nicedCache{};
+    {
+        UpkeepService keepingService{1};
+        UpkeepService nicingService{1, {}, 19};
+        keepingService.add(keptCache);
+        nicingService.add(nicedCache);
+        REQUIRE(waitUntil([&] { return keptCache.niceness.load() != -100 && nicedCache.niceness.load() != -100; }));
+    }
+    REQUIRE(keptCache.niceness.load() == processNiceness);
+    REQUIRE(nicedCache.niceness.load() == 19);
+}
+
+TEST_CASE("UpkeepService: Unknown CPU", "[UpkeepService]") {
+    REQUIRE_THROWS_AS(UpkeepService(1, {100000}), std::invalid_argument);
+}
+
+TEST_CASE("UpkeepService: Shutting down while the caches are in use loses no block", "[UpkeepService]") {
+    std::vector<std::unique_ptr<LockFreeLinkedMemCache>> memCaches{};
+    for (int i{0}; i < 8; ++i) {
+        memCaches.push_back(std::make_unique<LockFreeLinkedMemCache>(16, sizeof(PlainOldData)));
+    }
+    auto upkeepService = std::make_unique<UpkeepService>(2);
+    for (auto & memCache : memCaches) {
+        upkeepService->add(*memCache);
+    }
+
+    std::thread userThread{[&memCaches] {
+        for (int i{0}; i < 20000; ++i) {
+            std::vector<PooledBlock<LinkedMemBlock>> acquiredBlocks{};
+            for (auto & memCache : memCaches) {
+                acquiredBlocks.push_back(memCache->acquire());
+            }
+        }
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    upkeepService.reset();
+    userThread.join();
+
+    for (auto & memCache : memCaches) {
+        memCache->upkeep();
+        REQUIRE(memCache->getFreeBlocksCount() == 16);
+        REQUIRE(memCache->getAllocatedBlocksCount() == 16 + memCache->getRetiredBlocksCount());
+    }
+}